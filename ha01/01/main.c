@@ -3,28 +3,178 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "lib/bitmap.h"
 
+// threads (if enabled)
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// simd kernels on x86 (everything else takes the scalar loop)
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BRIGHTNESS_X86 1
+#endif
+
 #define MAX(x, y) ((x < y) ? y : x) // getting the maximum of two values
 #define MIN(x, y) ((x > y) ? y : x) // getting the minimum of two values
 
-// manipulating the brightnes of a bitmap (HSV)
-void manipulate(bitmap_pixel_hsv_t *pixels, uint32_t width, uint32_t height, int offset)
+// the bytes of a band of rows for a single thread (fits into the l2 cache of a core)
+#define BAND_BYTES (256 * 1024)
+
+// the decoded images that may wait in front of a stage of the batch pipeline, per thread of that stage (bounds the memory)
+#define BATCH_QUEUE_DEPTH 2
+
+// the most offsets of a ladder (-b 10,20,30)
+#define MAX_VARIANTS 16
+
+// the pixels the automatic mode meters at least (every how many rows it counts follows from the size of the image)
+#define AUTO_SAMPLE_PIXELS (2 * 1024 * 1024)
+
+// manipulating the brightness of the pixels [first, width) of a row, one pixel at a time
+void manipulate_row(bitmap_component_t *row, uint32_t first, uint32_t width, uint32_t pixel_size, int offset)
 {
-    for (uint32_t i = 0; i < width * height; i++) {
-        bitmap_pixel_hsv_t *current_pixel = &pixels[i];
+    // the v component is at the same place in both pixel formats, only the distance between two pixels differs
+    bitmap_component_t *v = row + first * pixel_size + offsetof(bitmap_pixel_hsv_t, v);
 
-        int pixel_value_v = (int)(current_pixel->v);
+    for (uint32_t x = first; x < width; x++, v += pixel_size) {
+        int pixel_value_v = (int)(*v);
         pixel_value_v += offset;
 
         pixel_value_v = MIN(255, MAX(0, pixel_value_v));
 
-        current_pixel->v = (bitmap_component_t)pixel_value_v;
+        *v = (bitmap_component_t)pixel_value_v;
+    }
+}
+
+#ifdef BRIGHTNESS_X86
+// filling a vector of bytes with the value at the v lanes and 0 everywhere else (h, s, the 4th component and a cut pixel at the end)
+// returns the number of whole pixels in a vector
+uint32_t v_lanes(uint8_t *lanes, uint32_t vector_size, uint32_t pixel_size, uint8_t value)
+{
+    uint32_t pixels = vector_size / pixel_size;
+
+    memset(lanes, 0, vector_size);
+
+    for (uint32_t i = 0; i < pixels; i++)
+        lanes[i * pixel_size + offsetof(bitmap_pixel_hsv_t, v)] = value;
+
+    return pixels;
+}
+
+// manipulating the brightness of 8 (resp. 10 packed) pixels at once with saturating byte adds and subtracts (avx2)
+// returns the number of pixels done, the rest of the row is left to the scalar loop
+__attribute__((target("avx2")))
+uint32_t manipulate_row_avx2(bitmap_component_t *row, uint32_t width, uint32_t pixel_size, int offset)
+{
+    uint8_t up[32], down[32];
+    uint32_t pixels = v_lanes(up, 32, pixel_size, (offset > 0) ? offset : 0);
+    v_lanes(down, 32, pixel_size, (offset < 0) ? -offset : 0);
+
+    __m256i add = _mm256_loadu_si256((__m256i*)up);
+    __m256i sub = _mm256_loadu_si256((__m256i*)down);
+
+    // packed pixels: a vector holds 10 pixels and 2 bytes of the next one, which are written back as they were
+    uint32_t x = 0;
+    for (; (x * pixel_size) + 32 <= width * pixel_size; x += pixels) {
+        __m256i *p = (__m256i*)(row + x * pixel_size);
+        _mm256_storeu_si256(p, _mm256_subs_epu8(_mm256_adds_epu8(_mm256_loadu_si256(p), add), sub));
+    }
+
+    return x;
+}
+
+// manipulating the brightness of 4 (resp. 5 packed) pixels at once with saturating byte adds and subtracts (sse2)
+// returns the number of pixels done, the rest of the row is left to the scalar loop
+__attribute__((target("sse2")))
+uint32_t manipulate_row_sse2(bitmap_component_t *row, uint32_t width, uint32_t pixel_size, int offset)
+{
+    uint8_t up[16], down[16];
+    uint32_t pixels = v_lanes(up, 16, pixel_size, (offset > 0) ? offset : 0);
+    v_lanes(down, 16, pixel_size, (offset < 0) ? -offset : 0);
+
+    __m128i add = _mm_loadu_si128((__m128i*)up);
+    __m128i sub = _mm_loadu_si128((__m128i*)down);
+
+    // packed pixels: a vector holds 5 pixels and 1 byte of the next one, which is written back as it was
+    uint32_t x = 0;
+    for (; (x * pixel_size) + 16 <= width * pixel_size; x += pixels) {
+        __m128i *p = (__m128i*)(row + x * pixel_size);
+        _mm_storeu_si128(p, _mm_subs_epu8(_mm_adds_epu8(_mm_loadu_si128(p), add), sub));
+    }
+
+    return x;
+}
+#endif
+
+// manipulating the brightnes of a bitmap view (HSV), packed or not
+// only the v bytes change, so the kernels work on the interleaved pixels in place (no float conversion, no buffer)
+void manipulate(bitmap_view_t *view, int offset)
+{
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    uint32_t (*manipulate_row_simd)(bitmap_component_t*, uint32_t, uint32_t, int) = NULL;
+
+#ifdef BRIGHTNESS_X86
+    // select the kernel once for the whole view
+    if (__builtin_cpu_supports("avx2"))      manipulate_row_simd = manipulate_row_avx2;
+    else if (__builtin_cpu_supports("sse2")) manipulate_row_simd = manipulate_row_sse2;
+#endif
+
+    for (uint32_t y = 0; y < view->heightPx; y++) {
+        bitmap_component_t *row = bitmapViewRow(view, y);
+        uint32_t x = (manipulate_row_simd != NULL) ? manipulate_row_simd(row, view->widthPx, pixel_size, offset) : 0;
+
+        manipulate_row(row, x, view->widthPx, pixel_size, offset);
     }
 }
 
+// the new v for every old v: the hsv kernel itself runs on a row of 256 pixels with all values
+void value_table_for(int offset, uint8_t *value_table)
+{
+    bitmap_pixel_hsv_t pixels[256] = { 0 };
+    for (uint32_t v = 0; v < 256; v++)
+        pixels[v].v = v;
+
+    bitmap_view_t view = bitmapViewFromBuffer(pixels, 256, 1, BITMAP_PIXEL_FORMAT_32);
+    manipulate(&view, offset);
+
+    for (uint32_t v = 0; v < 256; v++)
+        value_table[v] = pixels[v].v;
+}
+
+// manipulating the brightness of a view on all threads: every thread takes bands of rows that fit into its cache
+// with a value table, the view is rgb and r, g and b are scaled instead (the same as changing v, but without the hsv conversions)
+void manipulate_bands(bitmap_view_t *view, int offset, uint8_t *value_table)
+{
+    size_t row_bytes = (size_t)view->widthPx * bitmapPixelFormatSize(view->pixelFormat);
+    uint32_t band_rows = MAX(1, BAND_BYTES / row_bytes);
+    uint32_t bands = (view->heightPx + band_rows - 1) / band_rows;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (uint32_t band = 0; band < bands; band++) {
+        bitmap_view_t rows = bitmapViewCrop(*view, 0, band * band_rows, view->widthPx, band_rows);
+
+        if (value_table != NULL) bitmapScaleBrightness(&rows, value_table);
+        else                     manipulate(&rows, offset);
+    }
+}
+
+// the wall clock time in milliseconds (the cpu time of clock() adds up all threads)
+double wall_time_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
 // creating new file path using strncat() (file_path + darker/brigther + offset)
 void create_new_filename(char *old_file_path, int offset, char *modified_file_path)
 {
@@ -42,64 +192,580 @@ void create_new_filename(char *old_file_path, int offset, char *modified_file_pa
     strncat(modified_file_path, ".bmp", 255);
 }
 
-// reading, calling manipulate function and writing pixels back
-bitmap_error_t brighten_image(char *file_path, int offset)
+// checking whether the output of a file is at least as new as the file itself (like make does), a missing output is never up to date
+int output_up_to_date(char *file_path, int offset)
 {
-    // read the bitmap pixels
-    bitmap_error_t error;
-    uint32_t width, height;
-    bitmap_pixel_hsv_t *pixels;
+    char modified_file_path[256] = { 0 };
+    create_new_filename(file_path, offset, modified_file_path);
 
-    error = bitmapReadPixels(
-        file_path,
-        (bitmap_pixel_t**)&pixels,
-        &width,
-        &height,
-        BITMAP_COLOR_SPACE_HSV
-    );
+    struct stat input, output;
+    if (stat(file_path, &input) != 0 || stat(modified_file_path, &output) != 0)
+        return 0;
+
+    if (output.st_mtim.tv_sec != input.st_mtim.tv_sec)
+        return output.st_mtim.tv_sec > input.st_mtim.tv_sec;
+
+    return output.st_mtim.tv_nsec >= input.st_mtim.tv_nsec;
+}
+
+// printing the message of a bitmap error (nothing on success)
+void print_error(bitmap_error_t error, char *file_path)
+{
+    switch (error) {
+        case BITMAP_ERROR_INVALID_PATH:
+            fprintf(stderr, "The file path (%s) does not exist.\n", file_path);
+            break;
+        case BITMAP_ERROR_INVALID_FILE_FORMAT:
+            fprintf(stderr, "The file (%s) is not in the right format.\n", file_path);
+            break;
+        case BITMAP_ERROR_IO:
+            fprintf(stderr, "Error while reading file (%s).\n", file_path);
+            break;
+        case BITMAP_ERROR_MEMORY:
+            fprintf(stderr, "Error while writing file.\n");
+            break;
+        case BITMAP_ERROR_FILE_EXISTS:
+            fprintf(stderr, "Error: File does already exist.\n");
+            break;
+        default:
+            break;
+    }
+}
 
-    // if the bitmap read returns an error, skip the manipulation of the image
-    // the buffer is freed in the lib code
-    if (error != BITMAP_ERROR_SUCCESS) return error;
+// state of a streaming brightness job
+typedef struct {
+    int offset;
+    uint8_t *value_table;
+    double duration;
+} brighten_context_t;
 
-    clock_t start = clock();
-    // manipulate the pixels
-    manipulate(pixels, width, height, offset);
-    printf("C Loop Multiplication: %.6fms\n", (double)(clock() - start) / (CLOCKS_PER_SEC / 1000));
+// called by bitmapTransform for every band of rows, while the band is still in the cache (brightening can not fail)
+bitmap_error_t brighten_band(bitmap_view_t *band, uint32_t first_row, void *user_data)
+{
+    brighten_context_t *context = (brighten_context_t*)user_data;
 
+    double start = wall_time_ms();
+    manipulate_bands(band, context->offset, context->value_table);
+    context->duration += wall_time_ms() - start;
+    return BITMAP_ERROR_SUCCESS;
+}
 
+// reading, calling manipulate function and writing pixels back in one streaming pass
+bitmap_error_t brighten_image(char *file_path, int offset, bitmap_pixel_format_t pixel_format, uint8_t *value_table)
+{
     // get the new filename
-    char modified_file_path[256];
+    char modified_file_path[256] = { 0 };
     create_new_filename(file_path, offset, modified_file_path);
 
-    // parameters of the written image
+    // parameters of the written image (the size is taken from the input)
     bitmap_parameters_t params = {
-        .bottomUp = BITMAP_BOOL_TRUE,
-        .widthPx = width,
-        .heightPx = height,
         .colorDepth = BITMAP_COLOR_DEPTH_24,
         .compression = BITMAP_COMPRESSION_NONE,
         .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
-        .colorSpace = BITMAP_COLOR_SPACE_HSV
+        .colorSpace = (value_table != NULL) ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV,
+        .pixelFormat = pixel_format
     };
 
-    // write the pixels back
-    error = bitmapWritePixels(
+    brighten_context_t context = { .offset = offset, .value_table = value_table, .duration = 0 };
+
+    // decode, manipulate and encode band by band
+    // if the bitmap read returns an error, the manipulation of the image is skipped
+    bitmap_error_t error = bitmapTransform(
+        file_path,
         modified_file_path,
         BITMAP_BOOL_TRUE,
         &params,
-        (bitmap_pixel_t*)pixels
+        brighten_band,
+        &context
     );
 
-    // free the memory that has been allocated by the bitmap library
-    free(pixels);
+    if (error == BITMAP_ERROR_SUCCESS)
+        printf("C Loop Multiplication: %.6fms\n", context.duration);
+
+    return error;
+}
+
+// brightening an image at several offsets from a single decode (one conversion to hsv for all of them)
+// every band of the source is loaded once and copied into all variants while it is still in the cache, then the variants are written in parallel
+bitmap_error_t brighten_variants(char *file_path, int *offsets, uint32_t count, bitmap_pixel_format_t pixel_format, uint8_t (*value_tables)[256])
+{
+    bitmap_color_space_t color_space = (value_tables != NULL) ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV;
+    bitmap_parameters_t input;
+    bitmap_view_t source;
+
+    // the outputs keep the orientation of the input (like a streaming transform)
+    bitmap_error_t error = bitmapReadParameters(file_path, &input);
+    if (error == BITMAP_ERROR_SUCCESS)
+        error = bitmapReadView(file_path, &source, color_space, pixel_format);
+    if (error != BITMAP_ERROR_SUCCESS)
+        return error;
+
+    size_t row_bytes = (size_t)source.widthPx * bitmapPixelFormatSize(pixel_format);
+    bitmap_view_t variants[MAX_VARIANTS];
+    uint32_t allocated = 0;
+
+    for (; allocated < count; allocated++) {
+        void *data = malloc(row_bytes * source.heightPx);
+        if (data == NULL)
+            break;
+
+        variants[allocated] = bitmapViewFromBuffer(data, source.widthPx, source.heightPx, pixel_format);
+    }
+
+    if (allocated < count) {
+        for (uint32_t v = 0; v < allocated; v++)
+            free(variants[v].data);
+
+        free(source.data);
+        return BITMAP_ERROR_MEMORY;
+    }
+
+    uint32_t band_rows = MAX(1, BAND_BYTES / row_bytes);
+    uint32_t bands = (source.heightPx + band_rows - 1) / band_rows;
+
+    double start = wall_time_ms();
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (uint32_t band = 0; band < bands; band++) {
+        bitmap_view_t rows = bitmapViewCrop(source, 0, band * band_rows, source.widthPx, band_rows);
+
+        for (uint32_t v = 0; v < count; v++) {
+            bitmap_view_t variant_rows = bitmapViewCrop(variants[v], 0, band * band_rows, source.widthPx, band_rows);
+
+            for (uint32_t y = 0; y < rows.heightPx; y++)
+                memcpy(bitmapViewRow(&variant_rows, y), bitmapViewRow(&rows, y), row_bytes);
+
+            if (value_tables != NULL) bitmapScaleBrightness(&variant_rows, value_tables[v]);
+            else                      manipulate(&variant_rows, offsets[v]);
+        }
+    }
+
+    printf("C Loop Multiplication: %.6fms\n", wall_time_ms() - start);
+    free(source.data);
+
+    // parameters of the written images (the size is taken from the views)
+    bitmap_parameters_t params = {
+        .bottomUp = input.bottomUp,
+        .colorDepth = BITMAP_COLOR_DEPTH_24,
+        .compression = BITMAP_COMPRESSION_NONE,
+        .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
+        .colorSpace = color_space
+    };
+
+    bitmap_error_t errors[MAX_VARIANTS];
+
+    // the conversions back to rgb and the encoding of the variants are independent
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (uint32_t v = 0; v < count; v++) {
+        char modified_file_path[256] = { 0 };
+        create_new_filename(file_path, offsets[v], modified_file_path);
+
+        errors[v] = bitmapWriteView(modified_file_path, BITMAP_BOOL_TRUE, &params, &variants[v]);
+        free(variants[v].data);
+    }
+
+    for (uint32_t v = 0; v < count; v++) {
+        if (errors[v] != BITMAP_ERROR_SUCCESS)
+            return errors[v];
+    }
+
+    return BITMAP_ERROR_SUCCESS;
+}
+
+// the smallest value that at least percentile % of the pixels do not exceed
+uint32_t percentile_value(uint32_t *histogram, int percentile)
+{
+    uint64_t pixels = 0;
+    for (uint32_t v = 0; v < 256; v++)
+        pixels += histogram[v];
+
+    uint64_t rank = (pixels * percentile + 99) / 100;
+    uint64_t count = 0;
+    uint32_t value = 0;
+
+    while (value < 255 && (count += histogram[value]) < rank)
+        value++;
+
+    return value;
+}
+
+// the offset that moves the given percentile of the values to the same part of the range (50 moves the median to the middle)
+int auto_offset(uint32_t *histogram, int percentile)
+{
+    int target = (255 * percentile + 50) / 100;
+    int offset = target - (int)percentile_value(histogram, percentile);
+
+    return MIN(100, MAX(-100, offset));
+}
+
+// brightening an image by the offset its own histogram asks for: one decode, a pass over v that counts the values, then the kernel as usual
+bitmap_error_t brighten_auto(char *file_path, int percentile, bitmap_pixel_format_t pixel_format, int rgb)
+{
+    bitmap_color_space_t color_space = rgb ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV;
+    bitmap_parameters_t input;
+    bitmap_view_t view;
+
+    // the output keeps the orientation of the input (like a streaming transform)
+    bitmap_error_t error = bitmapReadParameters(file_path, &input);
+    if (error == BITMAP_ERROR_SUCCESS)
+        error = bitmapReadView(file_path, &view, color_space, pixel_format);
+    if (error != BITMAP_ERROR_SUCCESS)
+        return error;
+
+    // v of hsv pixels, or v = max(r, g, b) of rgb pixels
+    uint32_t component_mask = rgb ? 0x7 : 1u << offsetof(bitmap_pixel_hsv_t, v);
+    uint32_t histogram[256];
+
+    // a percentile of a few million pixels is as good as the one of all of them
+    uint64_t pixels = (uint64_t)view.widthPx * view.heightPx;
+    bitmap_view_t sample = bitmapViewSkipRows(view, MAX(1, pixels / AUTO_SAMPLE_PIXELS));
+
+    double start = wall_time_ms();
+    bitmapValueHistogram(&sample, component_mask, histogram);
+    double analysis = wall_time_ms() - start;
+
+    int offset = auto_offset(histogram, percentile);
+    printf("Auto exposure (%s): offset %d, analysis %.6fms\n", file_path, offset, analysis);
+
+    uint8_t value_table[256];
+    if (rgb)
+        value_table_for(offset, value_table);
+
+    start = wall_time_ms();
+    manipulate_bands(&view, offset, rgb ? value_table : NULL);
+    printf("C Loop Multiplication: %.6fms\n", wall_time_ms() - start);
+
+    char modified_file_path[256] = { 0 };
+    create_new_filename(file_path, offset, modified_file_path);
+
+    // parameters of the written image (the size is taken from the view)
+    bitmap_parameters_t params = {
+        .bottomUp = input.bottomUp,
+        .colorDepth = BITMAP_COLOR_DEPTH_24,
+        .compression = BITMAP_COMPRESSION_NONE,
+        .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
+        .colorSpace = color_space
+    };
+
+    error = bitmapWriteView(modified_file_path, BITMAP_BOOL_TRUE, &params, &view);
+
+    free(view.data);
     return error;
 }
 
+// reading a raw frame from stdin, calling manipulate function and writing the frame to stdout (for pipes between tools)
+bitmap_error_t brighten_frame(int offset, bitmap_pixel_format_t pixel_format, uint8_t *value_table)
+{
+    bitmap_view_t view;
+    bitmap_color_space_t color_space = (value_table != NULL) ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV;
+    bitmap_error_t error = bitmapReadFrame(stdin, &view, color_space, pixel_format);
+
+    if (error != BITMAP_ERROR_SUCCESS)
+        return error;
+
+    double start = wall_time_ms();
+    manipulate_bands(&view, offset, value_table);
+    double duration = wall_time_ms() - start;
+
+    // stdout belongs to the frame
+    fprintf(stderr, "C Loop Multiplication: %.6fms\n", duration);
+
+    error = bitmapWriteFrame(stdout, &view, color_space);
+
+    free(view.data);
+    return error;
+}
+
+// an image on its way through the batch pipeline
+typedef struct {
+    char *file_path;
+    bitmap_view_t view;
+    bitmap_bool_t bottom_up;
+} batch_job_t;
+
+// a bounded queue between two stages of the batch pipeline
+// a stage is done when the last thread of the stage before it has left the queue and the queue is empty
+typedef struct {
+    batch_job_t *jobs;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint32_t producers;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} batch_queue_t;
+
+int batch_queue_init(batch_queue_t *queue, uint32_t capacity, uint32_t producers)
+{
+    queue->jobs = (batch_job_t*)malloc(capacity * sizeof(batch_job_t));
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->producers = producers;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return queue->jobs != NULL;
+}
+
+void batch_queue_destroy(batch_queue_t *queue)
+{
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+
+    free(queue->jobs);
+}
+
+// waiting while the queue is full, the stages behind keep the memory bounded
+void batch_queue_push(batch_queue_t *queue, batch_job_t *job)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    while (queue->count == queue->capacity)
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+
+    queue->jobs[(queue->head + queue->count) % queue->capacity] = *job;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// waiting for the next job, returns 0 when there will be no more jobs
+int batch_queue_pop(batch_queue_t *queue, batch_job_t *job)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    while (queue->count == 0 && queue->producers > 0)
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+
+    int popped = queue->count > 0;
+
+    if (popped) {
+        *job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+
+        pthread_cond_signal(&queue->not_full);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+    return popped;
+}
+
+// a thread of the stage before is done (the last one wakes up everybody waiting for jobs)
+void batch_queue_leave(batch_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    if (--queue->producers == 0)
+        pthread_cond_broadcast(&queue->not_empty);
+
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// state of a batch: readers decode files into the decoded queue, workers manipulate them into the manipulated queue, writers encode them
+typedef struct {
+    char **file_paths;
+    uint32_t file_count;
+    uint32_t next_file;
+    int offset;
+    uint8_t *value_table;
+    bitmap_pixel_format_t pixel_format;
+    batch_queue_t decoded;
+    batch_queue_t manipulated;
+    uint32_t written;
+    uint32_t failed;
+} batch_t;
+
+void *batch_reader(void *user_data)
+{
+    batch_t *batch = (batch_t*)user_data;
+    bitmap_color_space_t color_space = (batch->value_table != NULL) ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV;
+    uint32_t index;
+
+    while ((index = __atomic_fetch_add(&batch->next_file, 1, __ATOMIC_RELAXED)) < batch->file_count) {
+        batch_job_t job = { .file_path = batch->file_paths[index] };
+
+        // the output keeps the orientation of the input (like a streaming transform)
+        bitmap_parameters_t params;
+        bitmap_error_t error = bitmapReadParameters(job.file_path, &params);
+
+        if (error == BITMAP_ERROR_SUCCESS) {
+            job.bottom_up = params.bottomUp;
+            error = bitmapReadView(job.file_path, &job.view, color_space, batch->pixel_format);
+        }
+
+        if (error != BITMAP_ERROR_SUCCESS) {
+            print_error(error, job.file_path);
+            __atomic_fetch_add(&batch->failed, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        batch_queue_push(&batch->decoded, &job);
+    }
+
+    batch_queue_leave(&batch->decoded);
+    return NULL;
+}
+
+// a worker takes a whole image at a time (the images are the parallelism here, not the bands)
+void *batch_worker(void *user_data)
+{
+    batch_t *batch = (batch_t*)user_data;
+    batch_job_t job;
+
+    while (batch_queue_pop(&batch->decoded, &job)) {
+        double start = wall_time_ms();
+
+        if (batch->value_table != NULL) bitmapScaleBrightness(&job.view, batch->value_table);
+        else                            manipulate(&job.view, batch->offset);
+
+        printf("C Loop Multiplication: %.6fms\n", wall_time_ms() - start);
+
+        batch_queue_push(&batch->manipulated, &job);
+    }
+
+    batch_queue_leave(&batch->manipulated);
+    return NULL;
+}
+
+void *batch_writer(void *user_data)
+{
+    batch_t *batch = (batch_t*)user_data;
+    batch_job_t job;
+
+    // parameters of the written images (the size and the orientation are taken from the jobs)
+    bitmap_parameters_t params = {
+        .colorDepth = BITMAP_COLOR_DEPTH_24,
+        .compression = BITMAP_COMPRESSION_NONE,
+        .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
+        .colorSpace = (batch->value_table != NULL) ? BITMAP_COLOR_SPACE_RGB : BITMAP_COLOR_SPACE_HSV
+    };
+
+    while (batch_queue_pop(&batch->manipulated, &job)) {
+        char modified_file_path[256] = { 0 };
+        create_new_filename(job.file_path, batch->offset, modified_file_path);
+
+        params.bottomUp = job.bottom_up;
+        bitmap_error_t error = bitmapWriteView(modified_file_path, BITMAP_BOOL_TRUE, &params, &job.view);
+        free(job.view.data);
+
+        if (error != BITMAP_ERROR_SUCCESS) {
+            print_error(error, job.file_path);
+            __atomic_fetch_add(&batch->failed, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&batch->written, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+// starting the threads of a stage, returns how many could be started
+// every thread that could not be started leaves the queue behind the stage right away, so the stages behind still finish
+uint32_t start_stage(pthread_t *threads, uint32_t count, void *(*stage)(void*), batch_t *batch, batch_queue_t *output)
+{
+    uint32_t started = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (pthread_create(&threads[started], NULL, stage, batch) == 0) started++;
+        else if (output != NULL)                                           batch_queue_leave(output);
+    }
+
+    return started;
+}
+
+// brightening many files in a pipeline: io_threads readers decode the next files while the workers manipulate and io_threads writers encode the ones before
+// at most BATCH_QUEUE_DEPTH images per thread wait between two stages, so the memory stays bounded for any number of files
+// returns 0 if the pipeline could not be started
+int brighten_batch(char **file_paths, uint32_t file_count, int offset, bitmap_pixel_format_t pixel_format, uint8_t *value_table, uint32_t workers, uint32_t io_threads)
+{
+    batch_t batch = {
+        .file_paths = file_paths,
+        .file_count = file_count,
+        .offset = offset,
+        .value_table = value_table,
+        .pixel_format = pixel_format
+    };
+
+    pthread_t *threads = (pthread_t*)malloc((workers + 2 * io_threads) * sizeof(pthread_t));
+    int queues = batch_queue_init(&batch.decoded, BATCH_QUEUE_DEPTH * workers, io_threads);
+    queues &= batch_queue_init(&batch.manipulated, BATCH_QUEUE_DEPTH * io_threads, workers);
+
+    if (threads == NULL || !queues) {
+        batch_queue_destroy(&batch.decoded);
+        batch_queue_destroy(&batch.manipulated);
+        free(threads);
+        return 0;
+    }
+
+    double start = wall_time_ms();
+
+    // back to front: a stage only starts if there is a stage behind it that takes its images
+    uint32_t writers = start_stage(threads, io_threads, batch_writer, &batch, NULL);
+    uint32_t started_workers = 0;
+    uint32_t readers = 0;
+
+    if (writers > 0)
+        started_workers = start_stage(threads + writers, workers, batch_worker, &batch, &batch.manipulated);
+    else
+        for (uint32_t i = 0; i < workers; i++) batch_queue_leave(&batch.manipulated);
+
+    if (started_workers > 0)
+        readers = start_stage(threads + writers + started_workers, io_threads, batch_reader, &batch, &batch.decoded);
+    else
+        for (uint32_t i = 0; i < io_threads; i++) batch_queue_leave(&batch.decoded);
+
+    for (uint32_t i = 0; i < writers + started_workers + readers; i++)
+        pthread_join(threads[i], NULL);
+
+    if (readers > 0)
+        printf("Batch: %u written, %u failed in %.6fms\n", batch.written, batch.failed, wall_time_ms() - start);
+
+    batch_queue_destroy(&batch.decoded);
+    batch_queue_destroy(&batch.manipulated);
+    free(threads);
+
+    return readers > 0;
+}
+
+// splitting a list of offsets (-b 10,-20,30), returns how many there are (more than MAX_VARIANTS if there are too many)
+uint32_t parse_offsets(char *list, int *offsets)
+{
+    uint32_t count = 0;
+    offsets[0] = 0;
+
+    for (char *value = strtok(list, ","); value != NULL; value = strtok(NULL, ",")) {
+        if (count == MAX_VARIANTS)
+            return MAX_VARIANTS + 1;
+
+        offsets[count++] = atoi(value);
+    }
+
+    return count;
+}
+
 void print_help()
 {
-    printf("Usage: ./brightness_changer.out fileName1 [fileName2 ... fileNameN] -b brightness_offset\n"
+    printf("Usage: ./brightness_changer.out fileName1 [fileName2 ... fileNameN] -b brightness_offset[,brightness_offset...] [-p] [-j threads] [-r] [-P io_threads] [-u] [-a percentile]\n"
            "The specified files should be bitmap files and the brightness_offset must be specified and should be in the range from -100 to 100 and not be equal to 0!\n"
+           "A list of offsets (e.g. -b -20,20,40) decodes every file once and writes a variant for every offset.\n"
+           "-p keeps the pixels packed (3 bytes per pixel) in memory, which moves less data\n"
+           "-j sets the number of threads that manipulate bands of rows [default: 1]\n"
+           "-r scales r, g and b directly instead of converting to hsv and back (much faster, within 1 of scaling them by the exact v'/v, but up to 12 away from the hsv path, which rounds h, s and v to 8 bits)\n"
+           "-P brightens the files in a pipeline: io_threads threads read, the threads of -j manipulate whole images and io_threads threads write\n"
+           "-a picks the offset of every file itself: the one that moves the given percentile of v to the same part of the range (-a 50 moves the median to the middle, -b is not needed)\n"
+           "-u skips the files whose output is at least as new as the file itself\n"
+           "A fileName of - reads a raw frame from stdin and writes the altered frame to stdout.\n"
            "The output of the program are bitmap files with the original name and additional information that shows how they were altered.\n");
 }
 
@@ -109,12 +775,44 @@ int main(int argc, char **argv)
     int opt;
     char *offset_str;
     char *load_file_path;
+    bitmap_pixel_format_t pixel_format = BITMAP_PIXEL_FORMAT_32;
+    int threads = 1;
+    int rgb = 0;
+    int io_threads = 0;
+    int skip_up_to_date = 0;
+    int percentile = 0;
 
-    while ((opt = getopt(argc, argv, "b:")) != -1) {
+    while ((opt = getopt(argc, argv, "b:pj:rP:ua:")) != -1) {
         switch (opt) {
             case 'b':
                 offset_str = optarg;
                 break;
+            case 'p':
+                pixel_format = BITMAP_PIXEL_FORMAT_24;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'r':
+                rgb = 1;
+                break;
+            case 'P':
+                io_threads = atoi(optarg);
+                if (io_threads < 1) {
+                    fprintf(stderr, "The number of io threads must be at least 1! Exiting...\n");
+                    return 1;
+                }
+                break;
+            case 'u':
+                skip_up_to_date = 1;
+                break;
+            case 'a':
+                percentile = atoi(optarg);
+                if (percentile < 1 || percentile > 99) {
+                    fprintf(stderr, "The percentile must be in the range from 1 to 99! Exiting...\n");
+                    return 1;
+                }
+                break;
             // triggered on unrecognized option
             case '?':
                 fprintf(stderr, "Unrecognized option -%c!\n", optopt);
@@ -123,15 +821,57 @@ int main(int argc, char **argv)
         }
     }
 
-    int offset = atoi(offset_str);
+    // the automatic mode picks the offset of every file itself
+    int offsets[MAX_VARIANTS] = { 0 };
+    uint32_t variant_count = (percentile > 0) ? 1 : parse_offsets(offset_str, offsets);
+    int offset = offsets[0];
+
+    if (variant_count > MAX_VARIANTS) {
+        fprintf(stderr, "There were more than %d offsets! Exiting...\n", MAX_VARIANTS);
+        return 1;
+    }
 
     // error handling for offset error
-    if (offset == 0) {
-        fprintf(stderr, "The offset was 0 or invalid! Exiting...\n\n");
-        print_help();
+    for (uint32_t v = 0; percentile == 0 && v < MAX(1, variant_count); v++) {
+        if (offsets[v] == 0) {
+            fprintf(stderr, "The offset was 0 or invalid! Exiting...\n\n");
+            print_help();
+            return 1;
+        } else if (offsets[v] < -100 || offsets[v] > 100) {
+            fprintf(stderr, "The offset was not in the valid range from -100 to 100! Exiting...\n");
+            return 1;
+        }
+    }
+
+    if ((variant_count > 1 || percentile > 0) && io_threads > 0) {
+        fprintf(stderr, "The pipeline takes a single fixed offset! Exiting...\n");
+        return 1;
+    }
+
+    if (threads < 1) {
+        fprintf(stderr, "The number of threads must be at least 1! Exiting...\n");
         return 1;
-    } else if (offset < -100 || offset > 100) {
-        fprintf(stderr, "The offset was not in the valid range from -100 to 100! Exiting...\n");
+    }
+
+#ifdef _OPENMP
+    // the library makes its bands bigger for more threads as well
+    omp_set_num_threads(threads);
+#endif
+
+    // the rgb mode needs the new v for every old one (for every offset)
+    uint8_t value_tables[MAX_VARIANTS][256];
+    uint8_t *value_table = value_tables[0];
+    if (rgb && percentile == 0) {
+        for (uint32_t v = 0; v < variant_count; v++)
+            value_table_for(offsets[v], value_tables[v]);
+    }
+
+    // the files of the pipeline (frames from stdin are always brightened right away)
+    char **batch_file_paths = NULL;
+    uint32_t batch_file_count = 0;
+
+    if (io_threads > 0 && (batch_file_paths = (char**)malloc(argc * sizeof(char*))) == NULL) {
+        fprintf(stderr, "Error while starting the pipeline.\n");
         return 1;
     }
 
@@ -140,26 +880,37 @@ int main(int argc, char **argv)
     for (uint32_t index = optind; index < argc; index++) {
         load_file_path = argv[index];
 
-        error = brighten_image(load_file_path, offset);
+        // a file is up to date when the outputs of all offsets are (the automatic offsets are not known before the analysis)
+        int up_to_date = skip_up_to_date && percentile == 0;
+        for (uint32_t v = 0; up_to_date && v < variant_count; v++)
+            up_to_date = output_up_to_date(load_file_path, offsets[v]);
 
-        switch (error) {
-            case BITMAP_ERROR_INVALID_PATH:
-                fprintf(stderr, "The file path (%s) does not exist.\n", load_file_path);
-                break;
-            case BITMAP_ERROR_INVALID_FILE_FORMAT:
-                fprintf(stderr, "The file (%s) is not in the right format.\n", load_file_path);
-                break;
-            case BITMAP_ERROR_IO:
-                fprintf(stderr, "Error while reading file (%s).\n", load_file_path);
-                break;
-            case BITMAP_ERROR_MEMORY:
-                fprintf(stderr, "Error while writing file.\n");
-                break;
-            case BITMAP_ERROR_FILE_EXISTS:
-                fprintf(stderr, "Error: File does already exist.\n");
-                break;
+        if (strcmp(load_file_path, "-") == 0 && (variant_count > 1 || percentile > 0)) {
+            fprintf(stderr, "A frame from stdin takes a single fixed offset.\n");
+            continue;
+        } else if (strcmp(load_file_path, "-") == 0) {
+            error = brighten_frame(offset, pixel_format, rgb ? value_table : NULL);
+        } else if (up_to_date) {
+            printf("Skipping %s, its output is up to date.\n", load_file_path);
+            continue;
+        } else if (percentile > 0) {
+            error = brighten_auto(load_file_path, percentile, pixel_format, rgb);
+        } else if (variant_count > 1) {
+            error = brighten_variants(load_file_path, offsets, variant_count, pixel_format, rgb ? value_tables : NULL);
+        } else if (batch_file_paths != NULL) {
+            batch_file_paths[batch_file_count++] = load_file_path;
+            continue;
+        } else {
+            error = brighten_image(load_file_path, offset, pixel_format, rgb ? value_table : NULL);
         }
+
+        print_error(error, load_file_path);
     }
 
+    if (batch_file_count > 0 && !brighten_batch(batch_file_paths, batch_file_count, offset, pixel_format, rgb ? value_table : NULL, threads, io_threads))
+        fprintf(stderr, "Error while starting the pipeline.\n");
+
+    free(batch_file_paths);
+
     return 0;
 }
@@ -0,0 +1,266 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lib/bitmap.h"
+#include "lib/convolve.h"
+#include "lib/median.h"
+#include "lib/lut.h"
+
+// the filters of this tool
+#define FILTER_NONE 0
+#define FILTER_GAUSSIAN 1
+#define FILTER_BOX 2
+#define FILTER_SHARPEN 3
+#define FILTER_MEDIAN 4
+
+// writing a view to a file in the row order of the input (the path - writes a raw frame to stdout)
+bitmap_error_t write_view(bitmap_view_t *view, char *output_file_path, bitmap_bool_t bottom_up, bitmap_color_space_t color_space)
+{
+    bitmap_parameters_t params =
+    {
+        .bottomUp = bottom_up,
+        .widthPx = view->widthPx,
+        .heightPx = view->heightPx,
+        .colorDepth = BITMAP_COLOR_DEPTH_24,
+        .compression = BITMAP_COMPRESSION_NONE,
+        .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
+        .colorSpace = color_space
+    };
+
+    // frames run from the top row down, so bottom-up rows are written through a flipped view
+    if (strcmp(output_file_path, "-") == 0) {
+        bitmap_view_t rows = bottom_up ? bitmapViewFlipVertical(*view) : *view;
+        return bitmapWriteFrame(stdout, &rows, color_space);
+    }
+
+    return bitmapWriteView(output_file_path, BITMAP_BOOL_TRUE, &params, view);
+}
+
+// reading a bitmap, filtering it, applying the point operations (if any) and writing it back
+// the path - reads resp. writes a raw frame from stdin resp. to stdout
+// in the HSV color space the median and the point operations only change V (the other filters do not work on HSV)
+bitmap_error_t filter_file(char *file_path, char *output_file_path, int filter, double parameter, double amount, bitmap_lut_t *lut, bitmap_pixel_format_t pixel_format, bitmap_color_space_t color_space)
+{
+    bitmap_error_t error;
+    bitmap_parameters_t input = { .bottomUp = BITMAP_BOOL_FALSE };
+    bitmap_view_t view;
+
+    // the output keeps the orientation of the input (raw frames are top-down)
+    if (strcmp(file_path, "-") == 0) {
+        error = bitmapReadFrame(stdin, &view, color_space, pixel_format);
+    } else {
+        error = bitmapReadParameters(file_path, &input);
+        if (error == BITMAP_ERROR_SUCCESS)
+            error = bitmapReadView(file_path, &view, color_space, pixel_format);
+    }
+
+    if (error != BITMAP_ERROR_SUCCESS)
+        return error;
+
+    // the point operations alone work in place, in a single pass
+    if (filter == FILTER_NONE) {
+        bitmapLutApplyView(&view, &view, lut);
+        error = write_view(&view, output_file_path, input.bottomUp, color_space);
+
+        free(view.data);
+        return error;
+    }
+
+    // the filters need a second image to write to
+    uint32_t pixel_size = bitmapPixelFormatSize(pixel_format);
+    void *data = malloc((size_t)view.widthPx * view.heightPx * pixel_size);
+
+    if (data == NULL) {
+        free(view.data);
+        return BITMAP_ERROR_MEMORY;
+    }
+
+    bitmap_view_t filtered = bitmapViewFromBuffer(data, view.widthPx, view.heightPx, pixel_format);
+
+    switch (filter) {
+        case FILTER_GAUSSIAN:
+            error = bitmapGaussianBlurView(&view, &filtered, parameter);
+            break;
+        case FILTER_BOX:
+            error = bitmapBoxBlurView(&view, &filtered, (uint32_t)parameter, (uint32_t)parameter);
+            break;
+        case FILTER_SHARPEN:
+            error = bitmapSharpenView(&view, &filtered, parameter, amount);
+            break;
+        case FILTER_MEDIAN:
+            error = bitmapMedianView(&view, &filtered, (uint32_t)parameter, (color_space == BITMAP_COLOR_SPACE_HSV) ? 0x4 : 0x7);
+            break;
+    }
+
+    free(view.data);
+
+    if (error != BITMAP_ERROR_SUCCESS) {
+        free(data);
+        return error;
+    }
+
+    // the point operations after the filter
+    if (lut != NULL)
+        bitmapLutApplyView(&filtered, &filtered, lut);
+
+    // write the pixels back
+    error = write_view(&filtered, output_file_path, input.bottomUp, color_space);
+
+    free(data);
+    return error;
+}
+
+void print_help()
+{
+    printf("Usage: ./filter.out fileName [-g sigma | -b radius | -s sigma [-a amount] | -m radius] [-B offset] [-C contrast] [-G gamma] [-L black,white] [-v] [-o outFileName] [-p]\n"
+           "-g blurs with a Gaussian of the given sigma (big sigmas cost the same as small ones)\n"
+           "-b applies a box filter (the mean of (2 * radius + 1)^2 pixels)\n"
+           "-s sharpens with an unsharp mask (a Gaussian of the given sigma), -a sets its amount [default: 1.0]\n"
+           "-m applies a median filter over (2 * radius + 1)^2 pixels (removes salt and pepper noise, any radius up to 127 costs the same)\n"
+           "-B adds an offset, -C scales the contrast around 128, -G applies a gamma correction and -L stretches the levels between black and white to 0 to 255\n"
+           "   these point operations are applied after the filter in the given order, all of them in a single pass\n"
+           "-v changes only the brightness (V of HSV) with the median and the point operations, so the colors stay as they are\n"
+           "-o sets the name of the output file [default: out.bmp]\n"
+           "-p keeps the pixels packed (3 bytes per pixel) in memory, which moves less data\n"
+           "A fileName or outFileName of - reads a raw frame from stdin resp. writes a raw frame to stdout\n"
+           );
+}
+
+int main(int argc, char** argv)
+{
+    // getting arguments from terminal input
+    int opt;
+    int filter = FILTER_NONE;
+    double parameter = 0.0;
+    double amount = 1.0;
+    char *new_file_path = "out.bmp";
+    bitmap_pixel_format_t pixel_format = BITMAP_PIXEL_FORMAT_32;
+    bitmap_color_space_t color_space = BITMAP_COLOR_SPACE_RGB;
+
+    // the point operations are composed into one table while parsing (on R, G and B, -v moves them to V afterwards)
+    bitmap_lut_t lut;
+    int point_operations = 0;
+    int black, white;
+    bitmapLutIdentity(&lut);
+
+    while ((opt = getopt(argc, argv, "g:b:s:a:m:B:C:G:L:vo:p")) != -1) {
+        switch (opt) {
+            case 'g':
+                filter = FILTER_GAUSSIAN;
+                parameter = atof(optarg);
+                break;
+            case 'b':
+                filter = FILTER_BOX;
+                parameter = atoi(optarg);
+                break;
+            case 's':
+                filter = FILTER_SHARPEN;
+                parameter = atof(optarg);
+                break;
+            case 'a':
+                amount = atof(optarg);
+                break;
+            case 'm':
+                filter = FILTER_MEDIAN;
+                parameter = atoi(optarg);
+                break;
+            case 'B':
+                bitmapLutOffset(&lut, BITMAP_LUT_RGB, atoi(optarg));
+                point_operations++;
+                break;
+            case 'C':
+                bitmapLutContrast(&lut, BITMAP_LUT_RGB, atof(optarg));
+                point_operations++;
+                break;
+            case 'G':
+                if (atof(optarg) <= 0.0) {
+                    fprintf(stderr, "The gamma must be greater than 0! Exiting...\n");
+                    return 1;
+                }
+                bitmapLutGamma(&lut, BITMAP_LUT_RGB, atof(optarg));
+                point_operations++;
+                break;
+            case 'L':
+                if (sscanf(optarg, "%d,%d", &black, &white) != 2 || black < 0 || white > 255 || black >= white) {
+                    fprintf(stderr, "The levels must be two values black,white with 0 <= black < white <= 255! Exiting...\n");
+                    return 1;
+                }
+                bitmapLutLevels(&lut, BITMAP_LUT_RGB, (uint8_t)black, (uint8_t)white);
+                point_operations++;
+                break;
+            case 'v':
+                color_space = BITMAP_COLOR_SPACE_HSV;
+                break;
+            case 'o':
+                new_file_path = optarg;
+                break;
+            case 'p':
+                pixel_format = BITMAP_PIXEL_FORMAT_24;
+                break;
+            // triggered on unrecognized option
+            case '?':
+                fprintf(stderr, "Unrecognized option -%c!\n", optopt);
+                print_help();
+                return -1;
+        }
+    }
+
+    // error handling for the filter input
+    if ((filter == FILTER_NONE && point_operations == 0) || optind >= argc) {
+        fprintf(stderr, "The program needs a file path and a filter or a point operation!\n");
+        print_help();
+        return 1;
+    }
+
+    if (filter != FILTER_NONE && ((filter == FILTER_BOX || filter == FILTER_MEDIAN) ? (parameter < 0.0) : (parameter <= 0.0))) {
+        fprintf(stderr, "The sigma resp. radius is out of range! Exiting...\n");
+        print_help();
+        return 1;
+    }
+
+    if (filter == FILTER_MEDIAN && parameter > BITMAP_MEDIAN_MAX_RADIUS) {
+        fprintf(stderr, "The radius of the median filter must not be bigger than %d! Exiting...\n", BITMAP_MEDIAN_MAX_RADIUS);
+        return 1;
+    }
+
+    if (color_space == BITMAP_COLOR_SPACE_HSV && filter != FILTER_MEDIAN && filter != FILTER_NONE) {
+        fprintf(stderr, "Only the median filter and the point operations work on the brightness alone!\n");
+        print_help();
+        return 1;
+    }
+
+    // in HSV, the chain moves from R (all three have the same table) to V
+    if (color_space == BITMAP_COLOR_SPACE_HSV) {
+        uint8_t chain[256];
+        memcpy(chain, lut.table[0], sizeof(chain));
+
+        bitmapLutIdentity(&lut);
+        bitmapLutMap(&lut, BITMAP_LUT_HSV_V, chain);
+    }
+
+    bitmap_error_t error = filter_file(argv[optind], new_file_path, filter, parameter, amount, (point_operations > 0) ? &lut : NULL, pixel_format, color_space);
+
+    // error handling for filtering
+    switch (error) {
+        case BITMAP_ERROR_INVALID_PATH:
+            fprintf(stderr, "The file path is invalid!\n");
+            break;
+        case BITMAP_ERROR_INVALID_FILE_FORMAT:
+            fprintf(stderr, "The file is not in the right file format!\n");
+            break;
+        case BITMAP_ERROR_IO:
+            fprintf(stderr, "Error while reading the file.\n");
+            break;
+        case BITMAP_ERROR_MEMORY:
+            fprintf(stderr, "Insufficient memory.\n");
+            break;
+        case BITMAP_ERROR_FILE_EXISTS:
+            fprintf(stderr, "Error: File does already exist.\n");
+            break;
+    }
+
+    return (error == BITMAP_ERROR_SUCCESS) ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+#include "blend.h"
+
+//Min / max:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BITMAP_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <math.h>
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+/**********************************************************************************************************************************************************************
+	Blending
+**********************************************************************************************************************************************************************/
+
+//The fixed point weights have 7 fractional bits (both weights of a pair have to fit into a signed byte for _mm256_maddubs_epi16):
+#define BITMAP_BLEND_SHIFT 7
+#define BITMAP_BLEND_ONE (1 << BITMAP_BLEND_SHIFT)
+
+//Internal function that blends the pixels [firstPx, widthPx) of a row (scalar), weight is alpha in fixed point and must be in [0, 128].
+//The same arithmetic as the AVX2 path, so the tails of the rows (and both pixel formats) get the same results.
+void bitmapBlendRow(uint8_t* targetRow, const uint8_t* sourceRow, uint32_t firstPx, uint32_t widthPx, uint32_t pixelSize, uint32_t weight)
+{
+	for (size_t i = (size_t)firstPx * pixelSize; i < (size_t)widthPx * pixelSize; i += pixelSize)
+	{
+		//R, G and B are the first three components in both pixel formats:
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			targetRow[i + c] = (uint8_t)(((targetRow[i + c] * weight) + (sourceRow[i + c] * (BITMAP_BLEND_ONE - weight))) >> BITMAP_BLEND_SHIFT);
+		}
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that blends the pixels of a row (AVX2), weight is alpha in fixed point and must be in [1, 127].
+//32 bytes at once: the bytes of both rows are interleaved, so a single multiply-add per 16 components forms target * weight + source * (128 - weight).
+//Returns the number of pixels done.
+__attribute__((target("avx2")))
+uint32_t bitmapBlendRow_AVX2(uint8_t* targetRow, const uint8_t* sourceRow, uint32_t widthPx, uint32_t pixelSize, uint32_t weight)
+{
+	const __m256i weights = _mm256_set1_epi16((int16_t)(((BITMAP_BLEND_ONE - weight) << 8) | weight));
+
+	//The fourth component of 32 bit pixels is taken from the target:
+	const __m256i keep = (pixelSize == 4) ? _mm256_set1_epi32((int32_t)0xFF000000) : _mm256_setzero_si256();
+
+	//Whole pixels in steps of 32 bytes:
+	uint32_t stepPx = (pixelSize == 4) ? 8 : 32;
+	uint32_t colPx = 0;
+
+	for (; colPx + stepPx <= widthPx; colPx += stepPx)
+	{
+		size_t i = (size_t)colPx * pixelSize;
+
+		for (uint32_t b = 0; b < stepPx * pixelSize; b += 32)
+		{
+			__m256i target = _mm256_loadu_si256((const __m256i*)&targetRow[i + b]);
+			__m256i source = _mm256_loadu_si256((const __m256i*)&sourceRow[i + b]);
+
+			//Unpacking and packing both work within the lanes, so the order of the bytes is kept:
+			__m256i low = _mm256_srli_epi16(_mm256_maddubs_epi16(_mm256_unpacklo_epi8(target, source), weights), BITMAP_BLEND_SHIFT);
+			__m256i high = _mm256_srli_epi16(_mm256_maddubs_epi16(_mm256_unpackhi_epi8(target, source), weights), BITMAP_BLEND_SHIFT);
+
+			__m256i blended = _mm256_blendv_epi8(_mm256_packus_epi16(low, high), target, keep);
+			_mm256_storeu_si256((__m256i*)&targetRow[i + b], blended);
+		}
+	}
+
+	return colPx;
+}
+#endif
+
+//User-accessible.
+bitmap_error_t bitmapBlendView(const bitmap_view_t* target, const bitmap_view_t* source, double alpha)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(target->pixelFormat);
+
+	if ((target->pixelFormat != source->pixelFormat) || !pixelSize)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	uint32_t widthPx = BITMAP_MIN(target->widthPx, source->widthPx);
+	uint32_t heightPx = BITMAP_MIN(target->heightPx, source->heightPx);
+
+	//The fixed point weight of the target (the rounding moves alpha by at most 1/256, which moves a component by less than 1):
+	long weight = lround(BITMAP_MIN(BITMAP_MAX(alpha, 0.0), 1.0) * BITMAP_BLEND_ONE);
+
+	//An alpha that rounds to 1 keeps the target, one that rounds to 0 copies the source (without the fourth component):
+	if (weight == BITMAP_BLEND_ONE)
+	{
+		return BITMAP_ERROR_SUCCESS;
+	}
+
+	bitmap_bool_t avx2 = BITMAP_BOOL_FALSE;
+
+#ifdef BITMAP_X86
+	avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
+
+	//Every thread blends a band of consecutive rows:
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < heightPx; rowPx++)
+	{
+		uint8_t* targetRow = bitmapViewRow(target, rowPx);
+		const uint8_t* sourceRow = bitmapViewRow(source, rowPx);
+		uint32_t colPx = 0;
+
+		if (weight == 0)
+		{
+			if (pixelSize == 3)
+			{
+				memcpy(targetRow, sourceRow, (size_t)widthPx * pixelSize);
+			}
+			else
+			{
+				bitmapBlendRow(targetRow, sourceRow, 0, widthPx, pixelSize, 0);
+			}
+
+			continue;
+		}
+
+#ifdef BITMAP_X86
+		if (avx2)
+		{
+			colPx = bitmapBlendRow_AVX2(targetRow, sourceRow, widthPx, pixelSize, (uint32_t)weight);
+		}
+#endif
+
+		bitmapBlendRow(targetRow, sourceRow, colPx, widthPx, pixelSize, (uint32_t)weight);
+	}
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+/**********************************************************************************************************************************************************************
+	Compositing
+**********************************************************************************************************************************************************************/
+
+//Internal function that puts a source pixel over a target pixel (both 32 bit, straight alpha in c3).
+//The colors are premultiplied with their alpha (scaled by 255), composited and divided by the alpha of the result again (rounded).
+static inline void bitmapCompositePixel(uint8_t* target, const uint8_t* source)
+{
+	uint32_t sourceAlpha = source[3];
+
+	if (sourceAlpha == 255)
+	{
+		memcpy(target, source, 4);
+		return;
+	}
+
+	if (sourceAlpha == 0)
+	{
+		return;
+	}
+
+	//The part of the target that shines through (scaled by 255 * 255 together with the premultiplied colors):
+	uint32_t targetWeight = target[3] * (255 - sourceAlpha);
+	uint32_t alpha = (sourceAlpha * 255) + targetWeight;
+
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		uint32_t premultiplied = (source[c] * sourceAlpha * 255) + (target[c] * targetWeight);
+		target[c] = (uint8_t)((premultiplied + (alpha / 2)) / alpha);
+	}
+
+	target[3] = (uint8_t)((alpha + 127) / 255);
+}
+
+//Internal function that composites the pixels [firstPx, widthPx) of a row (scalar).
+void bitmapCompositeRow(uint8_t* targetRow, const uint8_t* sourceRow, uint32_t firstPx, uint32_t widthPx)
+{
+	for (uint32_t colPx = firstPx; colPx < widthPx; colPx++)
+	{
+		bitmapCompositePixel(&targetRow[4 * colPx], &sourceRow[4 * colPx]);
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that composites the pixels of a row (AVX2).
+//The alphas of 32 source pixels become two masks (movemask): spans that are fully transparent leave the target alone, fully opaque ones are copied,
+//only the pixels in between are composited one by one. Returns the number of pixels done.
+__attribute__((target("avx2")))
+uint32_t bitmapCompositeRow_AVX2(uint8_t* targetRow, const uint8_t* sourceRow, uint32_t widthPx)
+{
+	const __m256i alphaMask = _mm256_set1_epi32((int32_t)0xFF000000);
+	uint32_t colPx = 0;
+
+	for (; colPx + 32 <= widthPx; colPx += 32)
+	{
+		const uint8_t* source = &sourceRow[4 * colPx];
+		uint8_t* target = &targetRow[4 * colPx];
+
+		__m256i pixels[4];
+
+		for (uint32_t v = 0; v < 4; v++)
+		{
+			pixels[v] = _mm256_loadu_si256((const __m256i*)&source[32 * v]);
+		}
+
+		//The common case of an overlay first: all 32 pixels are transparent.
+		__m256i any = _mm256_or_si256(_mm256_or_si256(pixels[0], pixels[1]), _mm256_or_si256(pixels[2], pixels[3]));
+
+		if (_mm256_testz_si256(any, alphaMask))
+		{
+			continue;
+		}
+
+		uint32_t transparent = 0;
+		uint32_t opaque = 0;
+
+		//A bit per pixel (the sign bits of the 32 bit comparisons):
+		for (uint32_t v = 0; v < 4; v++)
+		{
+			__m256i alpha = _mm256_and_si256(pixels[v], alphaMask);
+
+			transparent |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(alpha, _mm256_setzero_si256()))) << (8 * v);
+			opaque |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(alpha, alphaMask))) << (8 * v);
+		}
+
+		if (opaque == 0xFFFFFFFF)
+		{
+			for (uint32_t v = 0; v < 4; v++)
+			{
+				_mm256_storeu_si256((__m256i*)&target[32 * v], pixels[v]);
+			}
+
+			continue;
+		}
+
+		//Only the visible pixels, lowest bit first:
+		for (uint32_t visible = ~transparent; visible != 0; visible &= visible - 1)
+		{
+			uint32_t i = (uint32_t)__builtin_ctz(visible);
+
+			if (opaque & (1u << i))
+			{
+				memcpy(&target[4 * i], &source[4 * i], 4);
+			}
+			else
+			{
+				bitmapCompositePixel(&target[4 * i], &source[4 * i]);
+			}
+		}
+	}
+
+	return colPx;
+}
+#endif
+
+//User-accessible.
+bitmap_error_t bitmapCompositeView(const bitmap_view_t* target, const bitmap_view_t* source)
+{
+	if ((target->pixelFormat != BITMAP_PIXEL_FORMAT_32) || (source->pixelFormat != BITMAP_PIXEL_FORMAT_32))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	uint32_t widthPx = BITMAP_MIN(target->widthPx, source->widthPx);
+	uint32_t heightPx = BITMAP_MIN(target->heightPx, source->heightPx);
+
+	bitmap_bool_t avx2 = BITMAP_BOOL_FALSE;
+
+#ifdef BITMAP_X86
+	avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
+
+	//Every thread composites a band of consecutive rows:
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < heightPx; rowPx++)
+	{
+		uint8_t* targetRow = bitmapViewRow(target, rowPx);
+		const uint8_t* sourceRow = bitmapViewRow(source, rowPx);
+		uint32_t colPx = 0;
+
+#ifdef BITMAP_X86
+		if (avx2)
+		{
+			colPx = bitmapCompositeRow_AVX2(targetRow, sourceRow, widthPx);
+		}
+#endif
+
+		bitmapCompositeRow(targetRow, sourceRow, colPx, widthPx);
+	}
+
+	return BITMAP_ERROR_SUCCESS;
+}
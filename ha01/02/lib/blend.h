@@ -0,0 +1,36 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+//Alpha blending builds on top of the bitmap library:
+#include "bitmap.h"
+
+/**********************************************************************************************************************************************************************
+	Blend a source view into a target view: every component of R, G and B becomes target * alpha + source * (1 - alpha), alpha in [0, 1].
+	Only the overlap of both views is blended (the top left corner of the rows), the rest of the target stays as it is. The fourth component of 32 bit pixels is kept.
+	The blending is done in fixed point: alpha is rounded to 1/128 and the sums are truncated like the double formula,
+	so every component is within 1 of (uint8_t)(target * alpha + source * (1 - alpha)). An alpha of 0 or 1 copies resp. keeps the pixels exactly.
+	With AVX2 (if available) 32 bytes are blended at once, the rest of a row gets the same arithmetic, so the result does not depend on the pixel format or the processor.
+	The rows of the overlap are split into one band per thread (OpenMP, if enabled), so the blending itself scales until the memory bandwidth is used up.
+	Both views must have the same pixel format.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The pixel formats differ or the pixel format is unknown.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapBlendView(const bitmap_view_t* target, const bitmap_view_t* source, double alpha);
+
+/**********************************************************************************************************************************************************************
+	Composite a source view over a target view with the alpha of every pixel (Porter-Duff "over"), the result is stored in the target.
+	Both views carry straight (not premultiplied) alpha in c3, 0 is transparent and 255 is opaque. A target without transparency has to be filled with 255 first.
+	Every pixel is premultiplied with its alpha, composited and divided by the new alpha again, so the colors of transparent pixels never bleed into the result.
+	Only the overlap of both views is composited (the top left corner of the rows), the rest of the target stays as it is.
+	With AVX2 (if available) the alphas of 32 source pixels are checked at once: fully transparent spans are skipped, fully opaque ones are copied,
+	so an overlay that is mostly transparent costs little more than reading its pixels once. The rows are split into one band per thread (OpenMP, if enabled).
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  A view is not in BITMAP_PIXEL_FORMAT_32.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapCompositeView(const bitmap_view_t* target, const bitmap_view_t* source);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+//Convolution builds on top of the bitmap library:
+#include "bitmap.h"
+
+/**********************************************************************************************************************************************************************
+	Filters.
+	All of them are separable: a horizontal pass, then a vertical pass. Pixels beyond the edges repeat the edge pixels.
+	The image is processed in bands of rows on all cores (OpenMP, if enabled). Each band runs its horizontal pass over its own rows plus the halo rows the vertical pass needs,
+	so there is no intermediate image and the band stays in the cache between both passes.
+
+	Both views must have the same dimensions and the same pixel format. They must not overlap.
+	All components are filtered independently, so this fits RGB pixels best (hue does not blur well).
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The dimensions or the pixel formats differ, a pixel format is unknown or a parameter is out of range.
+	- BITMAP_ERROR_MEMORY               Insufficient memory.
+**********************************************************************************************************************************************************************/
+
+//Convolve with a separable kernel. kernelX has 2 * radiusX + 1 weights, kernelY has 2 * radiusY + 1 weights (centered). Float lanes (AVX2 if available).
+bitmap_error_t bitmapConvolveView(const bitmap_view_t* input, const bitmap_view_t* output, const float* kernelX, uint32_t radiusX, const float* kernelY, uint32_t radiusY);
+
+//Box filter (the mean of (2 * radiusX + 1) x (2 * radiusY + 1) pixels). Sliding windows, so the cost per pixel does not depend on the radius.
+bitmap_error_t bitmapBoxBlurView(const bitmap_view_t* input, const bitmap_view_t* output, uint32_t radiusX, uint32_t radiusY);
+
+//Gaussian blur. Small sigmas use a real Gaussian kernel, big ones three box filters in a row (which come close and cost the same for any sigma).
+bitmap_error_t bitmapGaussianBlurView(const bitmap_view_t* input, const bitmap_view_t* output, double sigma);
+
+//Sharpen (unsharp mask): add amount times the difference to a Gaussian blur with the given sigma.
+bitmap_error_t bitmapSharpenView(const bitmap_view_t* input, const bitmap_view_t* output, double sigma, double amount);
+
+#endif
@@ -0,0 +1,243 @@
+#include "lut.h"
+
+//Min / max:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BITMAP_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+/**********************************************************************************************************************************************************************
+	Building
+**********************************************************************************************************************************************************************/
+
+//Internal function that rounds and clamps a value to a component.
+static inline uint8_t bitmapLutClamp(double value)
+{
+	return (uint8_t)lround(BITMAP_MIN(BITMAP_MAX(value, 0.0), 255.0));
+}
+
+//User-accessible.
+void bitmapLutIdentity(bitmap_lut_t* lut)
+{
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		for (uint32_t v = 0; v < 256; v++)
+		{
+			lut->table[c][v] = (uint8_t)v;
+		}
+	}
+}
+
+//User-accessible.
+void bitmapLutMap(bitmap_lut_t* lut, uint32_t componentMask, const uint8_t* map)
+{
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		if (componentMask & (1u << c))
+		{
+			for (uint32_t v = 0; v < 256; v++)
+			{
+				lut->table[c][v] = map[lut->table[c][v]];
+			}
+		}
+	}
+}
+
+//User-accessible.
+void bitmapLutCompose(bitmap_lut_t* lut, const bitmap_lut_t* next)
+{
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		bitmapLutMap(lut, 1u << c, next->table[c]);
+	}
+}
+
+//User-accessible.
+void bitmapLutOffset(bitmap_lut_t* lut, uint32_t componentMask, int offset)
+{
+	uint8_t map[256];
+
+	for (int v = 0; v < 256; v++)
+	{
+		map[v] = (uint8_t)BITMAP_MIN(255, BITMAP_MAX(0, v + offset));
+	}
+
+	bitmapLutMap(lut, componentMask, map);
+}
+
+//User-accessible.
+void bitmapLutRate(bitmap_lut_t* lut, uint32_t componentMask, float rate)
+{
+	uint8_t map[256];
+
+	//The same float operations (and truncation) as the SSE kernels of the brightness tools:
+	for (uint32_t v = 0; v < 256; v++)
+	{
+		float current = (float)v;
+		float delta = (rate < 0.0f) ? current : (255.0f - current);
+		float weightedDelta = delta * rate;
+
+		current = weightedDelta + current;
+		map[v] = (uint8_t)BITMAP_MIN(255.0f, BITMAP_MAX(0.0f, current));
+	}
+
+	bitmapLutMap(lut, componentMask, map);
+}
+
+//User-accessible.
+void bitmapLutGamma(bitmap_lut_t* lut, uint32_t componentMask, double gamma)
+{
+	uint8_t map[256];
+
+	for (uint32_t v = 0; v < 256; v++)
+	{
+		map[v] = bitmapLutClamp(255.0 * pow(v / 255.0, 1.0 / gamma));
+	}
+
+	bitmapLutMap(lut, componentMask, map);
+}
+
+//User-accessible.
+void bitmapLutContrast(bitmap_lut_t* lut, uint32_t componentMask, double factor)
+{
+	uint8_t map[256];
+
+	for (uint32_t v = 0; v < 256; v++)
+	{
+		map[v] = bitmapLutClamp(128.0 + (factor * ((double)v - 128.0)));
+	}
+
+	bitmapLutMap(lut, componentMask, map);
+}
+
+//User-accessible.
+void bitmapLutLevels(bitmap_lut_t* lut, uint32_t componentMask, uint8_t black, uint8_t white)
+{
+	uint8_t map[256];
+	double scale = 255.0 / BITMAP_MAX(1, (int)white - (int)black);
+
+	for (uint32_t v = 0; v < 256; v++)
+	{
+		map[v] = bitmapLutClamp(((double)v - black) * scale);
+	}
+
+	bitmapLutMap(lut, componentMask, map);
+}
+
+/**********************************************************************************************************************************************************************
+	Applying
+**********************************************************************************************************************************************************************/
+
+//Internal function that looks up the pixels [firstPx, widthPx) of a row (scalar).
+void bitmapLutRow(const uint8_t* inputRow, uint8_t* outputRow, uint32_t firstPx, uint32_t widthPx, uint32_t pixelSize, const uint8_t* tables)
+{
+	for (size_t i = (size_t)firstPx * pixelSize; i < (size_t)widthPx * pixelSize; i += pixelSize)
+	{
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			outputRow[i + c] = tables[(c * 256) + inputRow[i + c]];
+		}
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that looks up the pixels of a row (AVX2).
+//8 pixels at once: pixelSize gathers of 8 components each (component c of a pixel reads from tables[c * 256 + value]).
+//The gathers read 4 bytes per component, so the tables must have 3 bytes of padding. Returns the number of pixels done.
+__attribute__((target("avx2")))
+uint32_t bitmapLutRow_AVX2(const uint8_t* inputRow, uint8_t* outputRow, uint32_t widthPx, uint32_t pixelSize, const uint8_t* tables)
+{
+	//Which table every component of a gather uses (8 pixels are pixelSize gathers, so the pattern repeats):
+	__m256i offsets[4];
+
+	for (uint32_t g = 0; g < pixelSize; g++)
+	{
+		int32_t offset[8];
+
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			offset[i] = (int32_t)((((8 * g) + i) % pixelSize) * 256);
+		}
+
+		offsets[g] = _mm256_loadu_si256((const __m256i*)offset);
+	}
+
+	//The low byte of every int, first into the low 4 bytes of each lane, then both lanes together:
+	const __m256i lowBytes = _mm256_setr_epi8(
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+	);
+	const __m256i joinLanes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	uint32_t colPx = 0;
+
+	for (; colPx + 8 <= widthPx; colPx += 8)
+	{
+		size_t first = (size_t)colPx * pixelSize;
+
+		for (uint32_t g = 0; g < pixelSize; g++)
+		{
+			__m256i indices = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&inputRow[first + (8 * g)])), offsets[g]);
+			__m256i values = _mm256_i32gather_epi32((const int*)tables, indices, 1);
+
+			values = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(values, lowBytes), joinLanes);
+			_mm_storel_epi64((__m128i*)&outputRow[first + (8 * g)], _mm256_castsi256_si128(values));
+		}
+	}
+
+	return colPx;
+}
+#endif
+
+//User-accessible.
+bitmap_error_t bitmapLutApplyView(const bitmap_view_t* input, const bitmap_view_t* output, const bitmap_lut_t* lut)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(input->pixelFormat);
+
+	if ((input->pixelFormat != output->pixelFormat) || (input->widthPx != output->widthPx) || (input->heightPx != output->heightPx) || !pixelSize)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//All tables in a row, with the padding for the gathers:
+	uint8_t tables[(4 * 256) + 4];
+
+	memcpy(tables, lut->table, 4 * 256);
+	memset(&tables[4 * 256], 0, 4);
+
+	bitmap_bool_t avx2 = BITMAP_BOOL_FALSE;
+
+#ifdef BITMAP_X86
+	avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < input->heightPx; rowPx++)
+	{
+		const uint8_t* inputRow = bitmapViewRow(input, rowPx);
+		uint8_t* outputRow = bitmapViewRow(output, rowPx);
+		uint32_t colPx = 0;
+
+#ifdef BITMAP_X86
+		if (avx2)
+		{
+			colPx = bitmapLutRow_AVX2(inputRow, outputRow, input->widthPx, pixelSize, tables);
+		}
+#endif
+
+		bitmapLutRow(inputRow, outputRow, colPx, input->widthPx, pixelSize, tables);
+	}
+
+	return BITMAP_ERROR_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#ifndef LUT_H
+#define LUT_H
+
+//Lookup tables build on top of the bitmap library:
+#include "bitmap.h"
+
+//A point operation for every component of a pixel: component c with the value v becomes table[c][v].
+typedef struct {
+	uint8_t table[4][256];
+} bitmap_lut_t;
+
+//The masks of the components an operation changes (bit 0 for the first component):
+#define BITMAP_LUT_RGB 0x7
+#define BITMAP_LUT_HSV_V 0x4
+
+/**********************************************************************************************************************************************************************
+	Building lookup tables.
+	Every operation is composed with the ones before it (the new table is the operation applied to the old table), so a chain of operations stays a single table.
+	Only the components in the mask change, the rest keep their tables.
+**********************************************************************************************************************************************************************/
+
+//Start a chain: every value stays as it is.
+void bitmapLutIdentity(bitmap_lut_t* lut);
+
+//Apply any map of 256 values.
+void bitmapLutMap(bitmap_lut_t* lut, uint32_t componentMask, const uint8_t* map);
+
+//Apply all tables of another chain.
+void bitmapLutCompose(bitmap_lut_t* lut, const bitmap_lut_t* next);
+
+//Add an offset and clamp (the brightness offset of the HSV tools when applied to V).
+void bitmapLutOffset(bitmap_lut_t* lut, uint32_t componentMask, int offset);
+
+//Move towards 255 (rate > 0) or 0 (rate < 0) by the given part of the distance, rate in [-1, 1] (the brightness rate of the HSV tools when applied to V).
+void bitmapLutRate(bitmap_lut_t* lut, uint32_t componentMask, float rate);
+
+//Gamma correction: 255 * (v / 255)^(1 / gamma), gamma > 1 brightens the dark values.
+void bitmapLutGamma(bitmap_lut_t* lut, uint32_t componentMask, double gamma);
+
+//Contrast around the middle: 128 + factor * (v - 128), clamped.
+void bitmapLutContrast(bitmap_lut_t* lut, uint32_t componentMask, double factor);
+
+//Levels: black becomes 0, white becomes 255, everything in between is stretched linearly (and clamped outside). black must be less than white.
+void bitmapLutLevels(bitmap_lut_t* lut, uint32_t componentMask, uint8_t black, uint8_t white);
+
+/**********************************************************************************************************************************************************************
+	Apply a lookup table to every pixel of a view in a single pass (a gather of 8 components at once with AVX2, if available, rows on all cores with OpenMP, if enabled).
+	Works in place if both views are the same. Both views must have the same dimensions and the same pixel format.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The dimensions or the pixel formats differ or the pixel format is unknown.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapLutApplyView(const bitmap_view_t* input, const bitmap_view_t* output, const bitmap_lut_t* lut);
+
+#endif
@@ -0,0 +1,275 @@
+#include "median.h"
+
+//Min / max:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BITMAP_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <stdlib.h>
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+//The minimum number of rows per band.
+//Every band builds its column histograms from scratch (2 * radius + 1 rows), so bands grow with the radius.
+#define BITMAP_MEDIAN_BAND_ROWS 64
+
+//A histogram with two levels: coarse[i] is the sum of fine[16 * i] to fine[16 * i + 15].
+//That is 17 * 16 counts, so AVX2 adds or subtracts a whole histogram with 17 instructions.
+typedef struct {
+	uint16_t coarse[16];
+	uint16_t fine[256];
+} bitmap_histogram_t;
+
+/**********************************************************************************************************************************************************************
+	Histograms
+**********************************************************************************************************************************************************************/
+
+//Internal function that clamps a coordinate to [0, size).
+static inline uint32_t bitmapMedianClamp(int64_t index, uint32_t size)
+{
+	return (uint32_t)BITMAP_MIN(BITMAP_MAX(index, 0), (int64_t)size - 1);
+}
+
+//Internal function that finds the value with the given rank (the target-th smallest) in a histogram.
+//At most 16 coarse and 16 fine bins are visited.
+static inline uint8_t bitmapHistogramRank(const bitmap_histogram_t* histogram, uint32_t target)
+{
+	uint32_t sum = 0;
+	uint32_t bin = 0;
+
+	while ((sum + histogram->coarse[bin]) < target)
+	{
+		sum += histogram->coarse[bin++];
+	}
+
+	const uint16_t* fine = &histogram->fine[bin * 16];
+	uint32_t i = 0;
+
+	while ((sum += fine[i]) < target)
+	{
+		i++;
+	}
+
+	return (uint8_t)((bin * 16) + i);
+}
+
+//Internal function that slides a histogram: adds the entering one, subtracts the leaving one (scalar).
+static inline void bitmapHistogramSlide(bitmap_histogram_t* histogram, const bitmap_histogram_t* entering, const bitmap_histogram_t* leaving)
+{
+	uint16_t* counts = (uint16_t*)histogram;
+	const uint16_t* in = (const uint16_t*)entering;
+	const uint16_t* out = (const uint16_t*)leaving;
+
+	for (size_t i = 0; i < sizeof(bitmap_histogram_t) / sizeof(uint16_t); i++)
+	{
+		counts[i] += in[i] - out[i];
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that slides a histogram (AVX2): 17 times 16 counts.
+__attribute__((target("avx2")))
+static inline void bitmapHistogramSlide_AVX2(bitmap_histogram_t* histogram, const bitmap_histogram_t* entering, const bitmap_histogram_t* leaving)
+{
+	__m256i* counts = (__m256i*)histogram;
+	const __m256i* in = (const __m256i*)entering;
+	const __m256i* out = (const __m256i*)leaving;
+
+	for (size_t i = 0; i < sizeof(bitmap_histogram_t) / sizeof(__m256i); i++)
+	{
+		__m256i sum = _mm256_add_epi16(_mm256_loadu_si256(&counts[i]), _mm256_loadu_si256(&in[i]));
+
+		_mm256_storeu_si256(&counts[i], _mm256_sub_epi16(sum, _mm256_loadu_si256(&out[i])));
+	}
+}
+#endif
+
+//Internal function that adds a value to or removes it from the column histograms (one value per column).
+void bitmapColumnsUpdate(bitmap_histogram_t* columns, const uint8_t* values, uint32_t widthPx, uint32_t pixelSize, int delta)
+{
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	{
+		uint8_t value = values[colPx * pixelSize];
+
+		columns[colPx].fine[value] += delta;
+		columns[colPx].coarse[value >> 4] += delta;
+	}
+}
+
+/**********************************************************************************************************************************************************************
+	Rows
+**********************************************************************************************************************************************************************/
+
+//Internal function that sums the column histograms of the window of the first pixel of a row.
+void bitmapMedianWindow(const bitmap_histogram_t* columns, bitmap_histogram_t* window, uint32_t widthPx, uint32_t radius)
+{
+	uint16_t* counts = (uint16_t*)window;
+
+	memset(window, 0, sizeof(bitmap_histogram_t));
+
+	for (int64_t x = -(int64_t)radius; x <= (int64_t)radius; x++)
+	{
+		const uint16_t* column = (const uint16_t*)&columns[bitmapMedianClamp(x, widthPx)];
+
+		for (size_t i = 0; i < sizeof(bitmap_histogram_t) / sizeof(uint16_t); i++)
+		{
+			counts[i] += column[i];
+		}
+	}
+}
+
+//Internal function that filters a component of a row from the column histograms (scalar).
+void bitmapMedianRow(const bitmap_histogram_t* columns, bitmap_histogram_t* window, uint8_t* outputRow, uint32_t widthPx, uint32_t pixelSize, uint32_t radius)
+{
+	uint32_t target = ((((2 * radius) + 1) * ((2 * radius) + 1)) / 2) + 1;
+
+	bitmapMedianWindow(columns, window, widthPx, radius);
+
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	{
+		outputRow[colPx * pixelSize] = bitmapHistogramRank(window, target);
+
+		bitmapHistogramSlide(window, &columns[bitmapMedianClamp((int64_t)colPx + radius + 1, widthPx)], &columns[bitmapMedianClamp((int64_t)colPx - radius, widthPx)]);
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that filters a component of a row from the column histograms (AVX2).
+__attribute__((target("avx2")))
+void bitmapMedianRow_AVX2(const bitmap_histogram_t* columns, bitmap_histogram_t* window, uint8_t* outputRow, uint32_t widthPx, uint32_t pixelSize, uint32_t radius)
+{
+	uint32_t target = ((((2 * radius) + 1) * ((2 * radius) + 1)) / 2) + 1;
+
+	bitmapMedianWindow(columns, window, widthPx, radius);
+
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	{
+		outputRow[colPx * pixelSize] = bitmapHistogramRank(window, target);
+
+		bitmapHistogramSlide_AVX2(window, &columns[bitmapMedianClamp((int64_t)colPx + radius + 1, widthPx)], &columns[bitmapMedianClamp((int64_t)colPx - radius, widthPx)]);
+	}
+}
+#endif
+
+//Internal function that filters the rows [firstRowPx, firstRowPx + rows) (all components in the mask, one after the other).
+//The scratch memory holds a histogram per column plus the one of the window.
+void bitmapMedianBand(const bitmap_view_t* input, const bitmap_view_t* output, uint32_t firstRowPx, uint32_t rows, uint32_t radius, uint32_t componentMask, bitmap_histogram_t* scratch, bitmap_bool_t avx2)
+{
+	uint32_t widthPx = input->widthPx;
+	uint32_t heightPx = input->heightPx;
+	uint32_t pixelSize = bitmapPixelFormatSize(input->pixelFormat);
+
+	bitmap_histogram_t* columns = scratch;
+	bitmap_histogram_t* window = &scratch[widthPx];
+
+	//The components that are not filtered stay as they are:
+	for (uint32_t rowPx = firstRowPx; rowPx < firstRowPx + rows; rowPx++)
+	{
+		memcpy(bitmapViewRow(output, rowPx), bitmapViewRow(input, rowPx), (size_t)widthPx * pixelSize);
+	}
+
+	for (uint32_t c = 0; c < pixelSize; c++)
+	{
+		if (!(componentMask & (1u << c)))
+		{
+			continue;
+		}
+
+		//The column histograms of the first row:
+		memset(columns, 0, widthPx * sizeof(bitmap_histogram_t));
+
+		for (int64_t y = (int64_t)firstRowPx - radius; y <= (int64_t)firstRowPx + radius; y++)
+		{
+			bitmapColumnsUpdate(columns, bitmapViewRow(input, bitmapMedianClamp(y, heightPx)) + c, widthPx, pixelSize, 1);
+		}
+
+		for (uint32_t rowPx = firstRowPx; rowPx < firstRowPx + rows; rowPx++)
+		{
+			uint8_t* outputRow = bitmapViewRow(output, rowPx) + c;
+
+#ifdef BITMAP_X86
+			if (avx2)
+			{
+				bitmapMedianRow_AVX2(columns, window, outputRow, widthPx, pixelSize, radius);
+			}
+			else
+#endif
+			bitmapMedianRow(columns, window, outputRow, widthPx, pixelSize, radius);
+
+			//Slide the column histograms down by a row:
+			if (rowPx + 1 < firstRowPx + rows)
+			{
+				bitmapColumnsUpdate(columns, bitmapViewRow(input, bitmapMedianClamp((int64_t)rowPx + radius + 1, heightPx)) + c, widthPx, pixelSize, 1);
+				bitmapColumnsUpdate(columns, bitmapViewRow(input, bitmapMedianClamp((int64_t)rowPx - radius, heightPx)) + c, widthPx, pixelSize, -1);
+			}
+		}
+	}
+}
+
+/**********************************************************************************************************************************************************************
+	Median filter
+**********************************************************************************************************************************************************************/
+
+//User-accessible.
+bitmap_error_t bitmapMedianView(const bitmap_view_t* input, const bitmap_view_t* output, uint32_t radius, uint32_t componentMask)
+{
+	if ((input->pixelFormat != output->pixelFormat) || (input->widthPx != output->widthPx) || (input->heightPx != output->heightPx))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	if (!input->widthPx || !input->heightPx || !bitmapPixelFormatSize(input->pixelFormat) || (radius > BITMAP_MEDIAN_MAX_RADIUS))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	bitmap_bool_t avx2 = BITMAP_BOOL_FALSE;
+
+#ifdef BITMAP_X86
+	avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
+
+	uint32_t heightPx = input->heightPx;
+	uint32_t bandRows = BITMAP_MAX(BITMAP_MEDIAN_BAND_ROWS, 4 * ((2 * radius) + 1));
+	uint32_t bands = (heightPx + bandRows - 1) / bandRows;
+
+	size_t scratchBytes = ((size_t)input->widthPx + 1) * sizeof(bitmap_histogram_t);
+	int failed = 0;
+
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		bitmap_histogram_t* scratch = (bitmap_histogram_t*)malloc(scratchBytes);
+
+		if (!scratch)
+		{
+#ifdef _OPENMP
+			#pragma omp atomic write
+#endif
+			failed = 1;
+		}
+
+#ifdef _OPENMP
+		#pragma omp for schedule(dynamic)
+#endif
+		for (uint32_t band = 0; band < bands; band++)
+		{
+			if (scratch)
+			{
+				uint32_t firstRowPx = band * bandRows;
+
+				bitmapMedianBand(input, output, firstRowPx, BITMAP_MIN(bandRows, heightPx - firstRowPx), radius, componentMask, scratch, avx2);
+			}
+		}
+
+		free(scratch);
+	}
+
+	return failed ? BITMAP_ERROR_MEMORY : BITMAP_ERROR_SUCCESS;
+}
@@ -0,0 +1,26 @@
+#ifndef MEDIAN_H
+#define MEDIAN_H
+
+//The median filter builds on top of the bitmap library:
+#include "bitmap.h"
+
+//The biggest radius (the counts of a window have to fit into 16 bits):
+#define BITMAP_MEDIAN_MAX_RADIUS 127
+
+/**********************************************************************************************************************************************************************
+	Median filter over (2 * radius + 1) x (2 * radius + 1) pixels. Pixels beyond the edges repeat the edge pixels.
+	Every column keeps a histogram of its window, the histogram of the whole window slides along the row by adding the column that enters and subtracting the one that leaves.
+	The histograms have two levels (16 coarse bins over 256 fine ones), so a pixel costs the same for any radius: two histogram updates (AVX2 if available) and a short search.
+	The image is processed in bands of rows on all cores (OpenMP, if enabled).
+
+	Only the components whose bits are set in the mask are filtered (bit 0 for the first component, e.g. 0x7 for R, G and B or 0x4 for the V of HSV), the rest is copied.
+	Both views must have the same dimensions and the same pixel format. They must not overlap.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The dimensions or the pixel formats differ, the pixel format is unknown or the radius is too big.
+	- BITMAP_ERROR_MEMORY               Insufficient memory.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapMedianView(const bitmap_view_t* input, const bitmap_view_t* output, uint32_t radius, uint32_t componentMask);
+
+#endif
@@ -0,0 +1,417 @@
+#include "rotate.h"
+
+//Min:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+//The edge length of a tile in pixels:
+#define BITMAP_TILE_SIZE 8
+
+//The state of bitmapWriteOriented(...) for the band callback:
+typedef struct {
+	//The whole input:
+	const bitmap_view_t* view;
+
+	//What to do with it:
+	bitmap_orientation_t orientation;
+
+	//Use the AVX2 kernels?
+	bitmap_bool_t avx2;
+} bitmap_orient_state_t;
+
+/**********************************************************************************************************************************************************************
+	Kernels
+**********************************************************************************************************************************************************************/
+
+//Internal function that transposes a tile of rows x cols pixels (scalar).
+//Row r of the output tile is column r of the input tile.
+void bitmapTransposeTile(const uint8_t* input, int64_t inputStride, uint8_t* output, int64_t outputStride, uint32_t rows, uint32_t cols, uint32_t pixelSize)
+{
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		uint8_t* outputRow = output + (r * outputStride);
+
+		for (uint32_t c = 0; c < cols; c++)
+		{
+			const uint8_t* pixel = input + (c * inputStride) + (r * pixelSize);
+
+			for (uint32_t b = 0; b < pixelSize; b++)
+			{
+				outputRow[(c * pixelSize) + b] = pixel[b];
+			}
+		}
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal function that transposes a full tile of 8 x 8 pixels (BITMAP_PIXEL_FORMAT_32, AVX2).
+//Each row is a single register: pairs of pixels, then pairs of pairs are interleaved within the 128 bit lanes, the lanes are swapped last.
+__attribute__((target("avx2")))
+void bitmapTransposeTile_AVX2(const uint8_t* input, int64_t inputStride, uint8_t* output, int64_t outputStride)
+{
+	__m256i r0 = _mm256_loadu_si256((const __m256i*)(input + (0 * inputStride)));
+	__m256i r1 = _mm256_loadu_si256((const __m256i*)(input + (1 * inputStride)));
+	__m256i r2 = _mm256_loadu_si256((const __m256i*)(input + (2 * inputStride)));
+	__m256i r3 = _mm256_loadu_si256((const __m256i*)(input + (3 * inputStride)));
+	__m256i r4 = _mm256_loadu_si256((const __m256i*)(input + (4 * inputStride)));
+	__m256i r5 = _mm256_loadu_si256((const __m256i*)(input + (5 * inputStride)));
+	__m256i r6 = _mm256_loadu_si256((const __m256i*)(input + (6 * inputStride)));
+	__m256i r7 = _mm256_loadu_si256((const __m256i*)(input + (7 * inputStride)));
+
+	__m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+	__m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+	__m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+	__m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+	__m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+	__m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+	__m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+	__m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+	_mm256_storeu_si256((__m256i*)(output + (0 * outputStride)), _mm256_permute2x128_si256(u0, u4, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + (1 * outputStride)), _mm256_permute2x128_si256(u1, u5, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + (2 * outputStride)), _mm256_permute2x128_si256(u2, u6, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + (3 * outputStride)), _mm256_permute2x128_si256(u3, u7, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + (4 * outputStride)), _mm256_permute2x128_si256(u0, u4, 0x31));
+	_mm256_storeu_si256((__m256i*)(output + (5 * outputStride)), _mm256_permute2x128_si256(u1, u5, 0x31));
+	_mm256_storeu_si256((__m256i*)(output + (6 * outputStride)), _mm256_permute2x128_si256(u2, u6, 0x31));
+	_mm256_storeu_si256((__m256i*)(output + (7 * outputStride)), _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+//Internal function that reverses 8 pixels (BITMAP_PIXEL_FORMAT_32, AVX2).
+__attribute__((target("avx2")))
+void bitmapReversePixels_AVX2(const uint8_t* input, uint8_t* output)
+{
+	__m256i pixels = _mm256_loadu_si256((const __m256i*)input);
+
+	_mm256_storeu_si256((__m256i*)output, _mm256_permutevar8x32_epi32(pixels, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)));
+}
+#endif
+
+//Internal function that transposes a view into another one, tile by tile.
+//Each band of 8 output rows is a single job, its tiles come from 8 columns of the input.
+void bitmapTransposeView(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_bool_t avx2)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(input->pixelFormat);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t tileRowPx = 0; tileRowPx < output->heightPx; tileRowPx += BITMAP_TILE_SIZE)
+	{
+		uint32_t rows = BITMAP_MIN(BITMAP_TILE_SIZE, output->heightPx - tileRowPx);
+
+		for (uint32_t tileColPx = 0; tileColPx < output->widthPx; tileColPx += BITMAP_TILE_SIZE)
+		{
+			uint32_t cols = BITMAP_MIN(BITMAP_TILE_SIZE, output->widthPx - tileColPx);
+
+			//The output tile at (tileColPx, tileRowPx) is the input tile at (tileRowPx, tileColPx):
+			const uint8_t* inputTile = bitmapViewRow(input, tileColPx) + ((size_t)tileRowPx * pixelSize);
+			uint8_t* outputTile = bitmapViewRow(output, tileRowPx) + ((size_t)tileColPx * pixelSize);
+
+#ifdef BITMAP_X86
+			if (avx2 && (pixelSize == 4) && (rows == BITMAP_TILE_SIZE) && (cols == BITMAP_TILE_SIZE))
+			{
+				bitmapTransposeTile_AVX2(inputTile, input->strideBytes, outputTile, output->strideBytes);
+				continue;
+			}
+#endif
+
+			bitmapTransposeTile(inputTile, input->strideBytes, outputTile, output->strideBytes, rows, cols, pixelSize);
+		}
+	}
+}
+
+//Internal function that mirrors each row of a view into another one.
+void bitmapReverseRows(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_bool_t avx2)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(input->pixelFormat);
+	uint32_t widthPx = input->widthPx;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < input->heightPx; rowPx++)
+	{
+		const uint8_t* inputRow = bitmapViewRow(input, rowPx);
+		uint8_t* outputRow = bitmapViewRow(output, rowPx);
+		uint32_t colPx = 0;
+
+#ifdef BITMAP_X86
+		if (avx2 && (pixelSize == 4))
+		{
+			for (; colPx + 8 <= widthPx; colPx += 8)
+			{
+				bitmapReversePixels_AVX2(&inputRow[(size_t)(widthPx - colPx - 8) * 4], &outputRow[(size_t)colPx * 4]);
+			}
+		}
+#endif
+
+		//The rest of the row:
+		for (; colPx < widthPx; colPx++)
+		{
+			memcpy(&outputRow[(size_t)colPx * pixelSize], &inputRow[(size_t)(widthPx - colPx - 1) * pixelSize], pixelSize);
+		}
+	}
+}
+
+//Internal function that copies each row of a view into another one.
+void bitmapCopyRows(const bitmap_view_t* input, const bitmap_view_t* output)
+{
+	size_t rowBytes = (size_t)input->widthPx * bitmapPixelFormatSize(input->pixelFormat);
+
+	for (uint32_t rowPx = 0; rowPx < input->heightPx; rowPx++)
+	{
+		memcpy(bitmapViewRow(output, rowPx), bitmapViewRow(input, rowPx), rowBytes);
+	}
+}
+
+//Internal function that rearranges a view into another one (the views have been checked).
+//Everything is a transpose, a mirror or a copy. The rest are vertical flips of the views, which come for free.
+void bitmapOrient(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_orientation_t orientation, bitmap_bool_t avx2)
+{
+	bitmap_view_t flipped;
+	bitmap_view_t flippedOutput;
+
+	switch (orientation)
+	{
+	case BITMAP_ORIENTATION_ROTATE_90:
+
+		//The bottom row becomes the first column:
+		flipped = bitmapViewFlipVertical(*input);
+		bitmapTransposeView(&flipped, output, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_ROTATE_180:
+
+		flipped = bitmapViewFlipVertical(*input);
+		bitmapReverseRows(&flipped, output, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_ROTATE_270:
+
+		//The first row becomes the first column, bottom to top:
+		flipped = bitmapViewFlipVertical(*output);
+		bitmapTransposeView(input, &flipped, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_TRANSPOSE:
+
+		bitmapTransposeView(input, output, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_ANTI_TRANSPOSE:
+
+		//The last column becomes the first row, bottom to top:
+		flipped = bitmapViewFlipVertical(*input);
+		flippedOutput = bitmapViewFlipVertical(*output);
+		bitmapTransposeView(&flipped, &flippedOutput, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_FLIP_HORIZONTAL:
+
+		bitmapReverseRows(input, output, avx2);
+		break;
+
+	case BITMAP_ORIENTATION_FLIP_VERTICAL:
+
+		flipped = bitmapViewFlipVertical(*input);
+		bitmapCopyRows(&flipped, output);
+		break;
+	}
+}
+
+//Internal function that checks for the AVX2 kernels.
+bitmap_bool_t bitmapOrientAVX2()
+{
+#ifdef BITMAP_X86
+	return __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#else
+	return BITMAP_BOOL_FALSE;
+#endif
+}
+
+/**********************************************************************************************************************************************************************
+	Orientations
+**********************************************************************************************************************************************************************/
+
+//User-accessible.
+bitmap_bool_t bitmapOrientationSwapsAxes(bitmap_orientation_t orientation)
+{
+	return ((orientation == BITMAP_ORIENTATION_ROTATE_90) || (orientation == BITMAP_ORIENTATION_ROTATE_270) ||
+		(orientation == BITMAP_ORIENTATION_TRANSPOSE) || (orientation == BITMAP_ORIENTATION_ANTI_TRANSPOSE)) ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+}
+
+//User-accessible.
+bitmap_orientation_t bitmapViewOrientation(bitmap_orientation_t orientation, bitmap_bool_t bottomUp)
+{
+	//Rows in the order of the picture need nothing:
+	if (!bottomUp)
+	{
+		return orientation;
+	}
+
+	//Otherwise the operation is mirrored vertically on both sides:
+	switch (orientation)
+	{
+	case BITMAP_ORIENTATION_ROTATE_90:
+
+		return BITMAP_ORIENTATION_ROTATE_270;
+
+	case BITMAP_ORIENTATION_ROTATE_270:
+
+		return BITMAP_ORIENTATION_ROTATE_90;
+
+	case BITMAP_ORIENTATION_TRANSPOSE:
+
+		return BITMAP_ORIENTATION_ANTI_TRANSPOSE;
+
+	case BITMAP_ORIENTATION_ANTI_TRANSPOSE:
+
+		return BITMAP_ORIENTATION_TRANSPOSE;
+
+	default:
+
+		return orientation;
+	}
+}
+
+//User-accessible.
+bitmap_bool_t bitmapParseOrientation(const char* name, bitmap_orientation_t* orientation)
+{
+	static const char* names[] = { "rotate90", "rotate180", "rotate270", "transpose", "fliph", "flipv" };
+
+	for (bitmap_orientation_t i = 0; i < (bitmap_orientation_t)(sizeof(names) / sizeof(names[0])); i++)
+	{
+		if (strcmp(name, names[i]) == 0)
+		{
+			*orientation = i;
+			return BITMAP_BOOL_TRUE;
+		}
+	}
+
+	return BITMAP_BOOL_FALSE;
+}
+
+//User-accessible.
+bitmap_error_t bitmapOrientView(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_orientation_t orientation)
+{
+	//Check the orientation and the views:
+	if ((orientation < BITMAP_ORIENTATION_ROTATE_90) || (orientation > BITMAP_ORIENTATION_ANTI_TRANSPOSE))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	if ((input->pixelFormat != output->pixelFormat) || !bitmapPixelFormatSize(input->pixelFormat))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	bitmap_bool_t swapsAxes = bitmapOrientationSwapsAxes(orientation);
+
+	if ((output->widthPx != (swapsAxes ? input->heightPx : input->widthPx)) || (output->heightPx != (swapsAxes ? input->widthPx : input->heightPx)))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	bitmapOrient(input, output, orientation, bitmapOrientAVX2());
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+/**********************************************************************************************************************************************************************
+	Writing
+**********************************************************************************************************************************************************************/
+
+//Internal band callback of bitmapWriteOriented(...).
+//Every orientation maps a band of output rows onto a band of input rows or columns, which is rearranged the same way.
+bitmap_error_t bitmapWriteOrientedBand(bitmap_view_t* band, uint32_t firstRowPx, void* userData)
+{
+	bitmap_orient_state_t* state = (bitmap_orient_state_t*)userData;
+
+	uint32_t widthPx = state->view->widthPx;
+	uint32_t heightPx = state->view->heightPx;
+	uint32_t rows = band->heightPx;
+
+	bitmap_view_t input;
+
+	switch (state->orientation)
+	{
+	case BITMAP_ORIENTATION_ROTATE_90:
+	case BITMAP_ORIENTATION_TRANSPOSE:
+
+		input = bitmapViewCrop(*state->view, firstRowPx, 0, rows, heightPx);
+		break;
+
+	case BITMAP_ORIENTATION_ROTATE_270:
+	case BITMAP_ORIENTATION_ANTI_TRANSPOSE:
+
+		input = bitmapViewCrop(*state->view, widthPx - firstRowPx - rows, 0, rows, heightPx);
+		break;
+
+	case BITMAP_ORIENTATION_FLIP_HORIZONTAL:
+
+		input = bitmapViewCrop(*state->view, 0, firstRowPx, widthPx, rows);
+		break;
+
+	default:
+
+		//Rotating by 180 degrees or flipping vertically starts at the bottom:
+		input = bitmapViewCrop(*state->view, 0, heightPx - firstRowPx - rows, widthPx, rows);
+		break;
+	}
+
+	bitmapOrient(&input, band, state->orientation, state->avx2);
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//User-accessible.
+bitmap_error_t bitmapWriteOriented(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_view_t* view, bitmap_orientation_t orientation)
+{
+	//Check the orientation:
+	if ((orientation < BITMAP_ORIENTATION_ROTATE_90) || (orientation > BITMAP_ORIENTATION_ANTI_TRANSPOSE))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//A vertical flip is just another view:
+	if (orientation == BITMAP_ORIENTATION_FLIP_VERTICAL)
+	{
+		bitmap_view_t flipped = bitmapViewFlipVertical(*view);
+
+		return bitmapWriteView(filePath, overwriteExisting, parameters, &flipped);
+	}
+
+	//The dimensions of the result and the pixel format come from the view:
+	bitmap_bool_t swapsAxes = bitmapOrientationSwapsAxes(orientation);
+
+	bitmap_parameters_t orientedParameters = *parameters;
+	orientedParameters.widthPx = swapsAxes ? view->heightPx : view->widthPx;
+	orientedParameters.heightPx = swapsAxes ? view->widthPx : view->heightPx;
+	orientedParameters.pixelFormat = view->pixelFormat;
+
+	bitmap_orient_state_t state =
+	{
+		.view = view,
+		.orientation = orientation,
+		.avx2 = bitmapOrientAVX2()
+	};
+
+	return bitmapWriteBands(filePath, overwriteExisting, &orientedParameters, bitmapWriteOrientedBand, &state);
+}
@@ -0,0 +1,55 @@
+#ifndef ROTATE_H
+#define ROTATE_H
+
+//Rotating builds on top of the bitmap library:
+#include "bitmap.h"
+
+//How the pixels are rearranged.
+//Directions refer to the rows of the view with row 0 on top. Bottom-up bitmaps are read bottom row first, so a clockwise rotation of their rows looks counterclockwise
+//(see bitmapViewOrientation(...)).
+typedef int bitmap_orientation_t;
+
+#define BITMAP_ORIENTATION_ROTATE_90       0
+#define BITMAP_ORIENTATION_ROTATE_180      1
+#define BITMAP_ORIENTATION_ROTATE_270      2
+#define BITMAP_ORIENTATION_TRANSPOSE       3
+#define BITMAP_ORIENTATION_FLIP_HORIZONTAL 4
+#define BITMAP_ORIENTATION_FLIP_VERTICAL   5
+
+//The transpose along the other diagonal (what a transpose of the picture is for rows that run bottom to top):
+#define BITMAP_ORIENTATION_ANTI_TRANSPOSE  6
+
+/**********************************************************************************************************************************************************************
+	Rotate (clockwise), transpose (along either diagonal) or flip a view into another one.
+	Transposes walk the image in tiles of 8 x 8 pixels (transposed in registers with AVX2 if available), so both sides stay in the cache. Bands of rows are processed on all cores (OpenMP, if enabled).
+
+	Both views must have the same pixel format. The output view must have the dimensions of the result (width and height are swapped by 90 / 270 degree rotations and both transposes).
+	The views must not overlap.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The pixel formats differ or are unknown, the dimensions do not match or the orientation is unknown.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapOrientView(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_orientation_t orientation);
+
+/**********************************************************************************************************************************************************************
+	Write a rotated, transposed or flipped view to a bitmap file, band by band (see bitmapWriteBands(...)).
+	Each band is rearranged right before it is encoded, so this costs about the same as writing the view as it is and needs no second image in memory.
+	Use the provided bitmap parameters, but take the dimensions (of the result) and the pixel format from the view.
+
+	Errors: See bitmapWriteBands(...). An unknown orientation is reported as BITMAP_ERROR_INVALID_FILE_FORMAT.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapWriteOriented(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_view_t* view, bitmap_orientation_t orientation);
+
+//Does the orientation swap width and height?
+bitmap_bool_t bitmapOrientationSwapsAxes(bitmap_orientation_t orientation);
+
+//Which orientation of a view turns the picture the given way? The rows of the view run in the order of the file (bottom row first if bottomUp),
+//the result is in the same order. Rows that run bottom to top swap the rotations by 90 / 270 degrees and the two transposes, the rest stays.
+bitmap_orientation_t bitmapViewOrientation(bitmap_orientation_t orientation, bitmap_bool_t bottomUp);
+
+//Parse an orientation name ("rotate90", "rotate180", "rotate270", "transpose", "fliph" or "flipv"). Returns BITMAP_BOOL_FALSE for unknown names.
+bitmap_bool_t bitmapParseOrientation(const char* name, bitmap_orientation_t* orientation);
+
+#endif
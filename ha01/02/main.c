@@ -5,108 +5,346 @@
 #include <string.h>
 
 #include "lib/bitmap.h"
+#include "lib/resample.h"
+#include "lib/rotate.h"
+#include "lib/blend.h"
+
+// threads (if enabled)
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define MIN(x, y) ((x > y) ? y : x)
 
-// alpha blending of two RGB bitmaps
-void manipulate(bitmap_pixel_rgb_t *pixels1, bitmap_pixel_rgb_t *pixels2,
-                uint32_t width1, uint32_t height1,
-                uint32_t width2, uint32_t height2,
-                double alpha)
+// reading a bitmap, or a raw frame from stdin if the path is -
+bitmap_error_t read_input(char *file_path, bitmap_view_t *view, bitmap_pixel_format_t pixel_format)
 {
-    // calculation borders for blending (diffrent size of bitmaps)
-    uint32_t min_width = MIN(width1, width2);
-    uint32_t min_height = MIN(height1, height2);
-
-    // blending pixels together
-    for (uint32_t y = 0; y < min_height; y++) {
-        for (uint32_t x = 0; x < min_width; x++) {
-            uint32_t index1 = y * width1 + x;
-            uint32_t index2 = y * width2 + x;
-
-            bitmap_pixel_rgb_t *pixel1 = &pixels1[index1];
-            bitmap_pixel_rgb_t *pixel2 = &pixels2[index2];
-            
-            pixel1->r = (pixel1->r * alpha + (1 - alpha) * pixel2->r);
-            pixel1->g = (pixel1->g * alpha + (1 - alpha) * pixel2->g);
-            pixel1->b = (pixel1->b * alpha + (1 - alpha) * pixel2->b);
-        }
+    if (strcmp(file_path, "-") == 0)
+        return bitmapReadFrame(stdin, view, BITMAP_COLOR_SPACE_RGB, pixel_format);
+
+    return bitmapReadView(file_path, view, BITMAP_COLOR_SPACE_RGB, pixel_format);
+}
+
+// the fourth byte of 32 bit bitmaps (and of raw frames) is their alpha, all other bitmaps are read as opaque
+int has_alpha(char *file_path)
+{
+    bitmap_parameters_t parameters;
+
+    if (strcmp(file_path, "-") == 0)
+        return 1;
+
+    return bitmapReadParameters(file_path, &parameters) == BITMAP_ERROR_SUCCESS && parameters.colorDepth == BITMAP_COLOR_DEPTH_32;
+}
+
+// the rows of bottom-up bitmaps are read bottom row first, raw frames and top-down bitmaps start with the top row
+int bottom_up_rows(char *file_path)
+{
+    bitmap_parameters_t parameters;
+
+    if (strcmp(file_path, "-") == 0)
+        return 0;
+
+    return bitmapReadParameters(file_path, &parameters) != BITMAP_ERROR_SUCCESS || parameters.bottomUp;
+}
+
+// scaling the second view to the size of the first one (the old pixels are freed)
+bitmap_error_t resample_to(const bitmap_view_t *target, bitmap_view_t *view, bitmap_filter_t filter)
+{
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    void *data = malloc((size_t)target->widthPx * target->heightPx * pixel_size);
+
+    if (data == NULL)
+        return BITMAP_ERROR_MEMORY;
+
+    bitmap_view_t resampled = bitmapViewFromBuffer(data, target->widthPx, target->heightPx, view->pixelFormat);
+    bitmap_error_t error = bitmapResampleView(view, &resampled, filter);
+
+    if (error != BITMAP_ERROR_SUCCESS) {
+        free(data);
+        return error;
     }
+
+    free(view->data);
+    *view = resampled;
+    return BITMAP_ERROR_SUCCESS;
+}
+
+// rotating or flipping the picture of a view with the given row order (the old pixels are freed)
+bitmap_error_t orient(bitmap_view_t *view, bitmap_orientation_t orientation, int bottom_up)
+{
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    void *data = malloc((size_t)view->widthPx * view->heightPx * pixel_size);
+
+    if (data == NULL)
+        return BITMAP_ERROR_MEMORY;
+
+    bitmap_view_t oriented = bitmapOrientationSwapsAxes(orientation)
+        ? bitmapViewFromBuffer(data, view->heightPx, view->widthPx, view->pixelFormat)
+        : bitmapViewFromBuffer(data, view->widthPx, view->heightPx, view->pixelFormat);
+
+    bitmap_error_t error = bitmapOrientView(view, &oriented, bitmapViewOrientation(orientation, bottom_up));
+
+    if (error != BITMAP_ERROR_SUCCESS) {
+        free(data);
+        return error;
+    }
+
+    free(view->data);
+    *view = oriented;
+    return BITMAP_ERROR_SUCCESS;
 }
 
 // reading two bitmaps, calling alpha blending and writing back pixles
-bitmap_error_t alpha_blend(char *file_path1, char *file_path2, char *output_file_path, double alpha_blend)
+// a filter of -1 blends only the overlapping part if the sizes differ, otherwise the second bitmap is resampled first
+// an orientation of -1 leaves the second bitmap resp. the result as it is
+// composite puts the second bitmap over the first one with the alpha of every pixel instead (alpha_blend is ignored, the pixel format must be 32 bit)
+bitmap_error_t alpha_blend(char *file_path1, char *file_path2, char *output_file_path, double alpha_blend, bitmap_pixel_format_t pixel_format, bitmap_filter_t filter,
+                           bitmap_orientation_t orientation, bitmap_orientation_t output_orientation, int composite)
 {
     // read the bitmap pixels
     bitmap_error_t error1, error2;
-    uint32_t width1, width2, height1, height2;
-    bitmap_pixel_rgb_t *pixels1;
-    bitmap_pixel_rgb_t *pixels2;
+    bitmap_view_t view1;
+    bitmap_view_t view2;
 
     // error for bitmap #1
-    error1 = bitmapReadPixels(
-        file_path1,
-        (bitmap_pixel_t**)&pixels1,
-        &width1,
-        &height1,
-        BITMAP_COLOR_SPACE_RGB
-    );
+    error1 = read_input(file_path1, &view1, pixel_format);
 
     // error for bitmap #2
-    error2 = bitmapReadPixels(
-        file_path2,
-        (bitmap_pixel_t**)&pixels2,
-        &width2,
-        &height2,
-        BITMAP_COLOR_SPACE_RGB
-    );
+    error2 = read_input(file_path2, &view2, pixel_format);
 
     // handling bitmap reading errors
     // the pixel data is freed in the lib code on error
     if (error1 != BITMAP_ERROR_SUCCESS || error2 != BITMAP_ERROR_SUCCESS) {
 
         // free the data if one read succeeded
-        if(error1 == BITMAP_ERROR_SUCCESS) free(pixels1);
-        if(error2 == BITMAP_ERROR_SUCCESS) free(pixels2);
+        if(error1 == BITMAP_ERROR_SUCCESS) free(view1.data);
+        if(error2 == BITMAP_ERROR_SUCCESS) free(view2.data);
 
         return (error1 != BITMAP_ERROR_SUCCESS) ? error1 : error2;
     }
 
-    // calling alpha blendig
-    manipulate(pixels1, pixels2, width1, height1, width2, height2, alpha_blend);
+    // the result keeps the row order of the first bitmap (and an alpha channel if it has one)
+    int bottom_up = bottom_up_rows(file_path1);
+    int output_alpha = composite && has_alpha(file_path1);
+
+    // the second bitmap is brought into the row order of the first one (a vertical flip is the same in both orders)
+    if (bottom_up_rows(file_path2) != bottom_up) {
+        error1 = orient(&view2, BITMAP_ORIENTATION_FLIP_VERTICAL, bottom_up);
+
+        if (error1 != BITMAP_ERROR_SUCCESS) {
+            free(view1.data);
+            free(view2.data);
+            return error1;
+        }
+    }
+
+    // turning the second bitmap first (e.g. portrait scans)
+    if (orientation >= 0) {
+        error1 = orient(&view2, orientation, bottom_up);
+
+        if (error1 != BITMAP_ERROR_SUCCESS) {
+            free(view1.data);
+            free(view2.data);
+            return error1;
+        }
+    }
+
+    // matching the sizes
+    if (filter >= 0 && (view1.widthPx != view2.widthPx || view1.heightPx != view2.heightPx)) {
+        error1 = resample_to(&view1, &view2, filter);
+
+        if (error1 != BITMAP_ERROR_SUCCESS) {
+            free(view1.data);
+            free(view2.data);
+            return error1;
+        }
+    }
+
+    // calling alpha blendig resp. compositing (only the overlap if the sizes still differ, both views have the same pixel format)
+    if (composite)
+        bitmapCompositeView(&view1, &view2);
+    else
+        bitmapBlendView(&view1, &view2, alpha_blend);
 
     // write the pixels back
     bitmap_parameters_t params =
     {
-        .bottomUp = BITMAP_BOOL_TRUE,
-        .widthPx = width1,
-        .heightPx = height1,
-        .colorDepth = BITMAP_COLOR_DEPTH_24,
+        .bottomUp = bottom_up,
+        .widthPx = view1.widthPx,
+        .heightPx = view1.heightPx,
+        .colorDepth = output_alpha ? BITMAP_COLOR_DEPTH_32 : BITMAP_COLOR_DEPTH_24,
         .compression = BITMAP_COMPRESSION_NONE,
         .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
         .colorSpace = BITMAP_COLOR_SPACE_RGB
     };
 
-    // error handling for writing pixels
-    error1 = bitmapWritePixels(
-        output_file_path,
-        BITMAP_BOOL_TRUE,
-        &params,
-        (bitmap_pixel_t*)pixels1
-    );
+    // error handling for writing pixels (a raw frame to stdout if the path is -)
+    // the result is turned while it is written, band by band
+    if (strcmp(output_file_path, "-") == 0) {
+        if (output_orientation >= 0)
+            error1 = orient(&view1, output_orientation, bottom_up);
+
+        // frames run from the top row down, so bottom-up rows are written through a flipped view
+        if (error1 == BITMAP_ERROR_SUCCESS) {
+            bitmap_view_t rows = bottom_up ? bitmapViewFlipVertical(view1) : view1;
+            error1 = bitmapWriteFrame(stdout, &rows, BITMAP_COLOR_SPACE_RGB);
+        }
+    } else if (output_orientation >= 0) {
+        error1 = bitmapWriteOriented(
+            output_file_path,
+            BITMAP_BOOL_TRUE,
+            &params,
+            &view1,
+            bitmapViewOrientation(output_orientation, bottom_up)
+        );
+    } else {
+        error1 = bitmapWriteView(
+            output_file_path,
+            BITMAP_BOOL_TRUE,
+            &params,
+            &view1
+        );
+    }
 
     // free the memory that has been allocated by the bitmap library
-    free(pixels1);
-    free(pixels2);
+    free(view1.data);
+    free(view2.data);
     return error1;
 }
 
+// the state of a streaming blend: both bitmaps are read band by band, in step with the bands of the output
+typedef struct {
+    bitmap_band_reader_t *reader1;
+    bitmap_band_reader_t *reader2;
+    bitmap_parameters_t parameters2;
+    uint8_t *band2;
+    double alpha_blend;
+    int composite;
+    bitmap_error_t error;
+} stream_t;
+
+// called by bitmapWriteBands for every band of the output
+// the rows of the first bitmap are read straight into the band, the ones of the second one into a band of their own, both files at the same time
+// a failed read stops the writing, the error is kept to tell it apart from a failed write
+bitmap_error_t blend_band(bitmap_view_t *band, uint32_t first_row, void *user_data)
+{
+    stream_t *stream = (stream_t*)user_data;
+
+    // the band of the second bitmap is allocated with the first band (no later band is bigger)
+    if (stream->band2 == NULL) {
+        stream->band2 = (uint8_t*)malloc((size_t)stream->parameters2.widthPx * band->heightPx * bitmapPixelFormatSize(band->pixelFormat));
+
+        if (stream->band2 == NULL) {
+            stream->error = BITMAP_ERROR_MEMORY;
+            return stream->error;
+        }
+    }
+
+    // the second bitmap may have fewer rows (only the overlap is blended)
+    uint32_t rows2 = (first_row < stream->parameters2.heightPx) ? MIN(band->heightPx, stream->parameters2.heightPx - first_row) : 0;
+    bitmap_view_t band2 = bitmapViewFromBuffer(stream->band2, stream->parameters2.widthPx, rows2, band->pixelFormat);
+
+    bitmap_error_t error1 = BITMAP_ERROR_SUCCESS;
+    bitmap_error_t error2 = BITMAP_ERROR_SUCCESS;
+
+#ifdef _OPENMP
+    #pragma omp parallel sections num_threads(2)
+#endif
+    {
+#ifdef _OPENMP
+        #pragma omp section
+#endif
+        error1 = bitmapReadBand(stream->reader1, band);
+#ifdef _OPENMP
+        #pragma omp section
+#endif
+        if (rows2 > 0)
+            error2 = bitmapReadBand(stream->reader2, &band2);
+    }
+
+    if (error1 != BITMAP_ERROR_SUCCESS || error2 != BITMAP_ERROR_SUCCESS) {
+        stream->error = (error1 != BITMAP_ERROR_SUCCESS) ? error1 : error2;
+        return stream->error;
+    }
+
+    if (stream->composite) {
+        bitmapCompositeView(band, &band2);
+    } else {
+        bitmapBlendView(band, &band2, stream->alpha_blend);
+    }
+
+    return BITMAP_ERROR_SUCCESS;
+}
+
+// blending like alpha_blend, but band by band: only a band of each bitmap is in memory at once, no matter how many rows they have
+// the result is the same, there is just no resampling and no turning
+bitmap_error_t stream_blend(char *file_path1, char *file_path2, char *output_file_path, double alpha_blend, bitmap_pixel_format_t pixel_format, int composite)
+{
+    stream_t stream = { 0 };
+    bitmap_parameters_t parameters1;
+
+    stream.alpha_blend = alpha_blend;
+    stream.composite = composite;
+
+    bitmap_error_t error = bitmapOpenBands(file_path1, BITMAP_COLOR_SPACE_RGB, pixel_format, &parameters1, &stream.reader1);
+
+    if (error == BITMAP_ERROR_SUCCESS)
+        error = bitmapOpenBands(file_path2, BITMAP_COLOR_SPACE_RGB, pixel_format, &stream.parameters2, &stream.reader2);
+
+    if (error != BITMAP_ERROR_SUCCESS) {
+        bitmapCloseBands(stream.reader1);
+        return error;
+    }
+
+    // the rows of the second bitmap can not be turned around on the fly
+    if (parameters1.bottomUp != stream.parameters2.bottomUp) {
+        fprintf(stderr, "Streaming needs both files in the same row order (bottom-up or top-down)!\n");
+        bitmapCloseBands(stream.reader1);
+        bitmapCloseBands(stream.reader2);
+        return BITMAP_ERROR_INVALID_FILE_FORMAT;
+    }
+
+    // the output has the size and the row order of the first bitmap (and its alpha channel, if it is composited onto)
+    bitmap_parameters_t params =
+    {
+        .bottomUp = parameters1.bottomUp,
+        .widthPx = parameters1.widthPx,
+        .heightPx = parameters1.heightPx,
+        .colorDepth = (composite && parameters1.colorDepth == BITMAP_COLOR_DEPTH_32) ? BITMAP_COLOR_DEPTH_32 : BITMAP_COLOR_DEPTH_24,
+        .compression = BITMAP_COMPRESSION_NONE,
+        .dibHeaderFormat = BITMAP_DIB_HEADER_INFO,
+        .colorSpace = BITMAP_COLOR_SPACE_RGB,
+        .pixelFormat = pixel_format
+    };
+
+    error = bitmapWriteBands(output_file_path, BITMAP_BOOL_TRUE, &params, blend_band, &stream);
+
+    // the writing stops at the first band that could not be read, the incomplete output is not kept
+    if (stream.error != BITMAP_ERROR_SUCCESS)
+        remove(output_file_path);
+
+    bitmapCloseBands(stream.reader1);
+    bitmapCloseBands(stream.reader2);
+    free(stream.band2);
+    return error;
+}
+
 void print_help()
 {
-    printf("Usage: ./alpha_blender.out fileName1 fileName2 [-a alpha] [-o outFileName]\n"
+    printf("Usage: ./alpha_blender.out fileName1 fileName2 [-a alpha] [-A] [-o outFileName] [-p] [-j threads] [-s] [-r filter] [-t orientation] [-T orientation]\n"
            "The specified 2 files should be bitmap files. If more than 2 files are specified than the first and the last one are blended!\n"
            "-a changes the alpha value used for blending and should be between 0.0 and 1.0 [default: 0.5]\n"
+           "-A composites the second file over the first one with the alpha of every pixel instead (the fourth byte of 32 bit bitmaps, other bitmaps are opaque)\n"
+           "   the result has an alpha channel if the first file has one, -a is ignored and -p is not possible\n"
            "-o sets the name of the output file [default: out.bmp]\n"
+           "-p keeps the pixels packed (3 bytes per pixel) in memory, which moves less data\n"
+           "-j sets the number of threads that blend bands of rows [default: 1]\n"
+           "-s streams the files: both are read band by band at the same time and every band is written right away, so only a few rows of them are in memory\n"
+           "   (not with -r, -t, -T or -)\n"
+           "-r resamples the second file to the size of the first one (bilinear, bicubic or lanczos) [default: blend only the overlap]\n"
+           "-t turns the second file before blending (rotate90, rotate180, rotate270 clockwise, transpose, fliph or flipv)\n"
+           "-T turns the result (same orientations as -t)\n"
+           "A fileName or outFileName of - reads raw frames from stdin resp. writes a raw frame to stdout\n"
            );
 }
 
@@ -116,15 +354,49 @@ int main(int argc, char** argv)
     int opt;
     char *alpha_blending_str = "0.5";
     char *new_file_path = "out.bmp";
+    bitmap_pixel_format_t pixel_format = BITMAP_PIXEL_FORMAT_32;
+    bitmap_filter_t filter = -1;
+    bitmap_orientation_t orientation = -1;
+    bitmap_orientation_t output_orientation = -1;
+    int threads = 1;
+    int composite = 0;
+    int streaming = 0;
 
-    while ((opt = getopt(argc, argv, "a:o:")) != -1) {
+    while ((opt = getopt(argc, argv, "a:Ao:pj:sr:t:T:")) != -1) {
         switch (opt) {
             case 'a':
                 alpha_blending_str = optarg; 
                 break;
+            case 'A':
+                composite = 1;
+                break;
             case 'o':
                 new_file_path = optarg;
                 break;
+            case 'p':
+                pixel_format = BITMAP_PIXEL_FORMAT_24;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 's':
+                streaming = 1;
+                break;
+            case 'r':
+                if (!bitmapParseFilter(optarg, &filter)) {
+                    fprintf(stderr, "Unknown filter %s!\n", optarg);
+                    print_help();
+                    return -1;
+                }
+                break;
+            case 't':
+            case 'T':
+                if (!bitmapParseOrientation(optarg, (opt == 't') ? &orientation : &output_orientation)) {
+                    fprintf(stderr, "Unknown orientation %s!\n", optarg);
+                    print_help();
+                    return -1;
+                }
+                break;
             // triggered on unrecognized option
             case '?':
                 fprintf(stderr, "Unrecognized option -%c!\n", optopt);
@@ -142,6 +414,22 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    // the alpha of every pixel is the fourth byte, which packed pixels do not have
+    if (composite && pixel_format == BITMAP_PIXEL_FORMAT_24) {
+        fprintf(stderr, "Compositing needs the alpha channel, so -A and -p can not be combined! Exiting...\n");
+        return 1;
+    }
+
+    if (threads < 1) {
+        fprintf(stderr, "The number of threads must be at least 1! Exiting...\n");
+        return 1;
+    }
+
+#ifdef _OPENMP
+    // the library reads, resamples and writes with the same threads
+    omp_set_num_threads(threads);
+#endif
+
     // error handling for bitmap input
     bitmap_error_t error;
     char *bmp1 = NULL;
@@ -160,7 +448,17 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    error = alpha_blend(bmp1, bmp2, new_file_path, alpha);
+    // streaming needs files on both sides and keeps the rows where they are
+    if (streaming && (filter >= 0 || orientation >= 0 || output_orientation >= 0 ||
+                      strcmp(bmp1, "-") == 0 || strcmp(bmp2, "-") == 0 || strcmp(new_file_path, "-") == 0)) {
+        fprintf(stderr, "Streaming can not be combined with -r, -t, -T or raw frames! Exiting...\n");
+        return 1;
+    }
+
+    if (streaming)
+        error = stream_blend(bmp1, bmp2, new_file_path, alpha, pixel_format, composite);
+    else
+        error = alpha_blend(bmp1, bmp2, new_file_path, alpha, pixel_format, filter, orientation, output_orientation, composite);
 
     // error handling for alpha blending
     switch (error) {
@@ -0,0 +1,14 @@
+#!/bin/sh
+
+# compositing onto a raw frame of a 24 bit bitmap has to give the same pixels as compositing onto the bitmap itself (both are opaque)
+./filter.out bee.bmp -B 0 -o - 2>/dev/null | ./alpha_blender.out - overlay.bmp -A -o - 2>/dev/null > pipe.frame
+./alpha_blender.out bee.bmp overlay.bmp -A -o - 2>/dev/null > file.frame
+
+if cmp -s pipe.frame file.frame; then
+    echo "composite onto a 24 bit bitmap: pipe and file agree"
+    rm -f pipe.frame file.frame
+else
+    echo "composite onto a 24 bit bitmap: pipe and file differ"
+    rm -f pipe.frame file.frame
+    exit 1
+fi
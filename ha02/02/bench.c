@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include "lib/bitmap.h"
+#include "kernels.h"
+
+// threads (if enabled)
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MAX(x, y) ((x < y) ? y : x) // getting the maximum of two values
+#define MIN(x, y) ((x > y) ? y : x) // getting the minimum of two values
+
+// the pixels of a row of the benchmark buffers (not a multiple of 16, so every kernel has a tail in every row)
+#define BENCH_WIDTH 1021
+
+// the bytes a repetition moves through a kernel at least (small buffers are run many times in a row)
+#define BENCH_REPETITION_BYTES (64 * 1024 * 1024)
+
+// the working set of a thread: half of a level of the cache (the other half is left for everything else), dram is far beyond the last level
+typedef struct {
+    const char *name;
+    size_t bytes;
+} bench_size_t;
+
+// the working sets of a thread from the cache sizes of the machine (with the usual sizes where the system does not tell)
+// l1 and l2 belong to a core, the threads share l3 and dram
+void cache_sizes(bench_size_t *sizes, uint32_t threads)
+{
+    long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+
+    sizes[0] = (bench_size_t){ "l1", (l1 > 0 ? l1 : 32 * 1024) / 2 };
+    sizes[1] = (bench_size_t){ "l2", (l2 > 0 ? l2 : 1024 * 1024) / 2 };
+    sizes[2] = (bench_size_t){ "l3", (l3 > 0 ? l3 : 8 * 1024 * 1024) / 2 / threads };
+    sizes[3] = (bench_size_t){ "dram", MAX(4 * (size_t)(l3 > 0 ? l3 : 8 * 1024 * 1024), (size_t)256 * 1024 * 1024) / threads };
+}
+
+// the wall clock time in seconds
+double wall_time()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// pinning the calling thread to the index-th processor it may run on (wrapping around)
+int pin_thread(uint32_t index)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return 0;
+
+    uint32_t count = CPU_COUNT(&allowed);
+    uint32_t wanted = index % count;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && wanted-- == 0) {
+            cpu_set_t single;
+            CPU_ZERO(&single);
+            CPU_SET(cpu, &single);
+
+            return sched_setaffinity(0, sizeof(single), &single) == 0;
+        }
+    }
+
+    return 0;
+}
+
+// a buffer of random hsv pixels with the given number of rows
+bitmap_view_t random_view(uint32_t rows, bitmap_pixel_format_t pixel_format, uint32_t seed)
+{
+    size_t bytes = (size_t)BENCH_WIDTH * rows * bitmapPixelFormatSize(pixel_format);
+    uint8_t *data = (uint8_t*)malloc(bytes);
+
+    if (data != NULL) {
+        for (size_t i = 0; i < bytes; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[i] = (uint8_t)(seed >> 16);
+        }
+    }
+
+    return bitmapViewFromBuffer(data, BENCH_WIDTH, rows, pixel_format);
+}
+
+// the rates of the verification: every rate with three decimals from -1 to 1 (the tools are given two, the automatic rates are anything in between)
+#define VERIFY_RATE_STEPS 1000
+
+// running every kernel on the same pixels (all values of v, the rates of the sweep and the one of -b) and comparing the results with the scalar loop
+int verify_kernels(uint32_t widest, bitmap_pixel_format_t pixel_format, float brighten_rate)
+{
+    bitmap_view_t source = random_view(8, pixel_format, 42);
+    size_t bytes = (size_t)source.widthPx * source.heightPx * bitmapPixelFormatSize(pixel_format);
+    uint32_t differing[KERNEL_AVX512 + 1] = { 0 };
+    int identical = 1;
+
+    uint8_t *expected = (uint8_t*)malloc(bytes);
+    uint8_t *result = (uint8_t*)malloc(bytes);
+
+    if (source.data == NULL || expected == NULL || result == NULL) {
+        fprintf(stderr, "Not enough memory for the verification.\n");
+        free(source.data);
+        free(expected);
+        free(result);
+        return 0;
+    }
+
+    // the step after the sweep is the rate of -b
+    for (int32_t step = -VERIFY_RATE_STEPS; step <= VERIFY_RATE_STEPS + 1; step++) {
+        float rate = (step <= VERIFY_RATE_STEPS) ? (float)(step / (double)VERIFY_RATE_STEPS) : brighten_rate;
+
+        memcpy(expected, source.data, bytes);
+        bitmap_view_t view = bitmapViewFromBuffer(expected, source.widthPx, source.heightPx, pixel_format);
+        manipulate_scalar(&view, rate);
+
+        for (uint32_t kernel = KERNEL_SSE; kernel <= widest; kernel++) {
+            memcpy(result, source.data, bytes);
+            view = bitmapViewFromBuffer(result, source.widthPx, source.heightPx, pixel_format);
+            kernels[kernel](&view, rate);
+
+            if (memcmp(result, expected, bytes) == 0)
+                continue;
+
+            // only the first difference of a kernel is shown, the others are counted
+            if (differing[kernel]++ == 0) {
+                size_t first = 0;
+                while (result[first] == expected[first])
+                    first++;
+
+                fprintf(stderr, "The %s kernel differs from the scalar one (rate %g, byte %zu: %d instead of %d).\n",
+                        kernel_names[kernel], rate, first, result[first], expected[first]);
+            }
+
+            identical = 0;
+        }
+    }
+
+    for (uint32_t kernel = KERNEL_SSE; kernel <= widest; kernel++) {
+        if (differing[kernel] > 0)
+            fprintf(stderr, "The %s kernel differs at %u of %u rates.\n", kernel_names[kernel], differing[kernel], 2 * VERIFY_RATE_STEPS + 2);
+    }
+
+    free(source.data);
+    free(expected);
+    free(result);
+
+    return identical;
+}
+
+// the time stamp counter per second (the cycles of the benchmark are reference cycles at this rate)
+double tsc_frequency()
+{
+    double start = wall_time();
+    uint64_t start_tsc = __rdtsc();
+
+    while (wall_time() - start < 0.1)
+        ;
+
+    return (__rdtsc() - start_tsc) / (wall_time() - start);
+}
+
+// runs a kernel on a buffer of every thread, returns the best seconds and tsc cycles of a repetition (of passes passes over every buffer)
+void bench_kernel(manipulate_function_t manipulate, bitmap_view_t *views, uint32_t threads, float brighten_rate, uint32_t passes, uint32_t warmups, uint32_t repetitions, double *best_seconds, double *best_cycles)
+{
+    *best_seconds = 1e300;
+    *best_cycles = 1e300;
+
+    for (uint32_t repetition = 0; repetition < warmups + repetitions; repetition++) {
+        double seconds = 0;
+        double cycles = 0;
+
+#ifdef _OPENMP
+        #pragma omp parallel num_threads(threads) reduction(max:seconds) reduction(max:cycles)
+#endif
+        {
+#ifdef _OPENMP
+            uint32_t thread = omp_get_thread_num();
+            #pragma omp barrier
+#else
+            uint32_t thread = 0;
+#endif
+            double start = wall_time();
+            uint64_t start_tsc = __rdtsc();
+
+            for (uint32_t pass = 0; pass < passes; pass++)
+                manipulate(&views[thread], brighten_rate);
+
+            cycles = (double)(__rdtsc() - start_tsc);
+            seconds = wall_time() - start;
+        }
+
+        // the warmups bring the buffers into the caches and the cores up to speed
+        if (repetition >= warmups) {
+            *best_seconds = MIN(*best_seconds, seconds);
+            *best_cycles = MIN(*best_cycles, cycles);
+        }
+    }
+}
+
+void print_help()
+{
+    printf("Usage: ./brightness_bench.out [-b brightness_rate] [-p] [-j threads] [-w warmups] [-n repetitions]\n"
+           "Runs every brightness kernel the machine supports on buffers that fit into l1, l2 and l3 and on one that only fits into dram.\n"
+           "Every thread works on its own buffer and is pinned to its own processor. The best of the repetitions is reported.\n"
+           "Before that, all kernels are checked against the scalar loop with every rate with three decimals and the one of -b (the exit code is 1 if one differs).\n"
+           "-b sets the rate the kernels apply [default: 0.5]\n"
+           "-p keeps the pixels packed (3 bytes per pixel) in memory\n"
+           "-j sets the number of threads [default: 1]\n"
+           "-w sets the number of warmup repetitions [default: 2]\n"
+           "-n sets the number of measured repetitions [default: 5]\n"
+           "bytes is the buffer of a thread. cycles/px are reference cycles of the time stamp counter per pixel of a thread, GB/s are the bytes of all buffers the kernels read (and write back) per second.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    float brighten_rate = 0.5f;
+    bitmap_pixel_format_t pixel_format = BITMAP_PIXEL_FORMAT_32;
+    int threads = 1;
+    int warmups = 2;
+    int repetitions = 5;
+
+    while ((opt = getopt(argc, argv, "b:pj:w:n:")) != -1) {
+        switch (opt) {
+            case 'b':
+                brighten_rate = (float)atof(optarg);
+                break;
+            case 'p':
+                pixel_format = BITMAP_PIXEL_FORMAT_24;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'w':
+                warmups = atoi(optarg);
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            // triggered on unrecognized option
+            case '?':
+                fprintf(stderr, "Unrecognized option -%c!\n", optopt);
+                print_help();
+                return -1;
+        }
+    }
+
+    if (brighten_rate < -1.0f || brighten_rate > 1.0f) {
+        fprintf(stderr, "The offset was not in the valid range from -1 to 1! Exiting...\n");
+        return 1;
+    }
+
+    if (threads < 1 || warmups < 0 || repetitions < 1) {
+        fprintf(stderr, "At least 1 thread and 1 repetition are needed! Exiting...\n");
+        return 1;
+    }
+
+#ifndef _OPENMP
+    threads = 1;
+#endif
+
+    uint32_t widest = supported_kernel();
+    uint32_t pixel_size = bitmapPixelFormatSize(pixel_format);
+
+    int identical = verify_kernels(widest, pixel_format, brighten_rate);
+    printf("Verification: %s (scalar to %s, %u bytes per pixel, %u rates)\n", identical ? "all kernels identical" : "KERNELS DIFFER", kernel_names[widest], pixel_size, 2 * VERIFY_RATE_STEPS + 2);
+
+    bench_size_t sizes[4];
+    cache_sizes(sizes, threads);
+
+    double frequency = tsc_frequency();
+    printf("Time stamp counter: %.2f GHz, %d thread(s), rate %.2f\n\n", frequency / 1e9, threads, brighten_rate);
+    printf("%-6s %-5s %12s %10s %12s %10s\n", "kernel", "size", "bytes", "passes", "cycles/px", "GB/s");
+
+    for (uint32_t s = 0; s < 4; s++) {
+        uint32_t rows = MAX(1, sizes[s].bytes / ((size_t)BENCH_WIDTH * pixel_size));
+        size_t bytes = (size_t)BENCH_WIDTH * rows * pixel_size;
+        uint32_t passes = MAX(1, BENCH_REPETITION_BYTES / bytes);
+
+        // every thread fills its own buffer on its own processor (the first touch puts the pages next to it)
+        bitmap_view_t *views = (bitmap_view_t*)calloc(threads, sizeof(bitmap_view_t));
+        int allocated = views != NULL;
+
+#ifdef _OPENMP
+        #pragma omp parallel num_threads(threads) reduction(&&:allocated)
+#endif
+        {
+#ifdef _OPENMP
+            uint32_t thread = omp_get_thread_num();
+#else
+            uint32_t thread = 0;
+#endif
+            // the threads of the pool stay the same for all parallel regions, so they stay pinned
+            pin_thread(thread);
+
+            if (views != NULL) {
+                views[thread] = random_view(rows, pixel_format, thread + 1);
+                allocated = views[thread].data != NULL;
+            }
+        }
+
+        for (uint32_t kernel = KERNEL_SCALAR; allocated && kernel <= widest; kernel++) {
+            double seconds, cycles;
+            bench_kernel(kernels[kernel], views, threads, brighten_rate, passes, warmups, repetitions, &seconds, &cycles);
+
+            double pixels = (double)BENCH_WIDTH * rows * passes;
+            printf("%-6s %-5s %12zu %10u %12.3f %10.2f\n", kernel_names[kernel], sizes[s].name, bytes, passes,
+                   cycles / pixels, bytes * (double)passes * threads / seconds / 1e9);
+        }
+
+        if (!allocated)
+            fprintf(stderr, "Not enough memory for the %s buffers.\n", sizes[s].name);
+
+        for (int thread = 0; views != NULL && thread < threads; thread++)
+            free(views[thread].data);
+        free(views);
+    }
+
+    return identical ? 0 : 1;
+}
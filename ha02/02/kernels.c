@@ -0,0 +1,327 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <pmmintrin.h>
+#include <immintrin.h>
+
+#include "kernels.h"
+
+#define MAX(x, y) ((x < y) ? y : x) // getting the maximum of two values
+#define MIN(x, y) ((x > y) ? y : x) // getting the minimum of two values
+
+// the names of the kernels (for the BRIGHTNESS_KERNEL environment variable)
+const char *kernel_names[] = { "scalar", "sse", "avx2", "avx512" };
+
+// runs cpuid with the given leaf and subleaf
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ __volatile__ (
+        "cpuid"
+        :"=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+        :"a"(leaf), "c"(subleaf)
+    );
+}
+
+// returns the widest kernel the processor supports and the operating system has enabled
+// the avx registers are only saved on a context switch if the os says so (osxsave, then the register states in xcr0)
+uint32_t supported_kernel()
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t max_leaf = eax;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t ssse3 = ecx >> 9 & 1;
+    uint32_t osxsave = ecx >> 27 & 1;
+    uint32_t avx = ecx >> 28 & 1;
+
+    if (!ssse3)
+        return KERNEL_SCALAR;
+
+    if (!osxsave || !avx || max_leaf < 7)
+        return KERNEL_SSE;
+
+    // xmm and ymm state (bits 1 and 2), opmask and zmm state (bits 5 to 7)
+    uint32_t xcr0_low, xcr0_high;
+    __asm__ __volatile__ ("xgetbv" :"=a"(xcr0_low), "=d"(xcr0_high) :"c"(0));
+
+    if ((xcr0_low & 0x06) != 0x06)
+        return KERNEL_SSE;
+
+    cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t avx2 = ebx >> 5 & 1;
+    uint32_t avx512f = ebx >> 16 & 1;
+    uint32_t avx512bw = ebx >> 30 & 1;
+
+    if (!avx2)
+        return KERNEL_SSE;
+
+    if (!avx512f || !avx512bw || (xcr0_low & 0xe6) != 0xe6)
+        return KERNEL_AVX2;
+
+    return KERNEL_AVX512;
+}
+
+// shuffle masks for the v components of 4 pixels (packed or not)
+// gather moves the v of pixel i into the low byte of int lane i, scatter moves byte i back to the v of pixel i, keep clears the v bytes
+// the v component is at the same place in both pixel formats, only the distance between two pixels differs
+void v_shuffles(uint32_t pixel_size, __m128i *gather, __m128i *scatter, __m128i *keep)
+{
+    uint8_t g[16], s[16], k[16];
+    memset(g, 0x80, 16);
+    memset(s, 0x80, 16);
+    memset(k, 0xff, 16);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t position = i * pixel_size + offsetof(bitmap_pixel_hsv_t, v);
+
+        g[4 * i] = position;
+        s[position] = i;
+        k[position] = 0;
+    }
+
+    *gather = _mm_loadu_si128((__m128i*)g);
+    *scatter = _mm_loadu_si128((__m128i*)s);
+    *keep = _mm_loadu_si128((__m128i*)k);
+}
+
+// manipulating the brightness of the 8 pixels at the given address with avx2 (two halves of 4 pixels, the second one starts at pixel 4)
+// new_v_c = v_c + delta * brighten_rate as a weighted sum, all in registers
+__attribute__((target("avx2")))
+static inline void manipulate_block_avx2(bitmap_component_t *pixels, uint32_t pixel_size, __m256i gather, __m256i scatter, __m256i keep, __m256 brightness_rate_avx, int darken)
+{
+    bitmap_component_t *second = pixels + 4 * pixel_size;
+    __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i*)pixels)), _mm_loadu_si128((__m128i*)second), 1);
+    __m256 current = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(block, gather));
+
+    __m256 delta;
+    if (darken) delta = current;
+    else        delta = _mm256_sub_ps(_mm256_set1_ps(255.0f), current);
+
+    // a multiply and an add (no fused multiply-add), so the result is rounded like in the other kernels
+    __m256 weigthed_delta = _mm256_mul_ps(delta, brightness_rate_avx);
+    current = _mm256_add_ps(weigthed_delta, current);
+
+    // narrow to bytes with saturation (in each half) and put them back between h and s
+    __m256i v = _mm256_cvttps_epi32(current);
+    v = _mm256_packs_epi32(v, v);
+    v = _mm256_packus_epi16(v, v);
+
+    block = _mm256_or_si256(_mm256_and_si256(block, keep), _mm256_shuffle_epi8(v, scatter));
+
+    // packed pixels: the halves overlap, the second one has the new pixel 4 and is written last
+    _mm_storeu_si128((__m128i*)pixels, _mm256_castsi256_si128(block));
+    _mm_storeu_si128((__m128i*)second, _mm256_extracti128_si256(block, 1));
+}
+
+// manipulating the brightnes of a bitmap (HSV) and speed it up with avx2 intrinsics
+// a single pass over the interleaved pixels, no buffer
+__attribute__((target("avx2")))
+void manipulate_avx2(bitmap_view_t *view, float brighten_rate)
+{
+    uint32_t width = view->widthPx;
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    int darken = brighten_rate < 0;
+
+    // constants for the intrinsics calculation (the same shuffles in both halves)
+    __m128i gather, scatter, keep;
+    v_shuffles(pixel_size, &gather, &scatter, &keep);
+
+    __m256i gather_avx = _mm256_broadcastsi128_si256(gather);
+    __m256i scatter_avx = _mm256_broadcastsi128_si256(scatter);
+    __m256i keep_avx = _mm256_broadcastsi128_si256(keep);
+    __m256 brightness_rate_avx = _mm256_set1_ps(brighten_rate);
+
+    for (uint32_t y = 0; y < view->heightPx; y++) {
+        bitmap_component_t *row = bitmapViewRow(view, y);
+
+        // 8 pixels at once as long as the second half fits into the row
+        uint32_t x = 0;
+        for (; (x + 4) * pixel_size + 16 <= width * pixel_size; x += 8)
+            manipulate_block_avx2(row + x * pixel_size, pixel_size, gather_avx, scatter_avx, keep_avx, brightness_rate_avx, darken);
+
+        // the last pixels go through a copy on the stack (at most 9 packed ones)
+        if (x < width) {
+            bitmap_component_t tail[64] = { 0 };
+            memcpy(tail, row + x * pixel_size, (width - x) * pixel_size);
+
+            for (uint32_t i = 0; i < width - x; i += 8)
+                manipulate_block_avx2(tail + i * pixel_size, pixel_size, gather_avx, scatter_avx, keep_avx, brightness_rate_avx, darken);
+
+            memcpy(row + x * pixel_size, tail, (width - x) * pixel_size);
+        }
+    }
+}
+
+// manipulating the brightness of the 4 pixels at the given address with sse (16 bytes are read and written, the bytes after a packed block stay as they were)
+// new_v_c = v_c + delta * brighten_rate, all in registers
+__attribute__((target("ssse3")))
+static inline void manipulate_block_sse(bitmap_component_t *pixels, __m128i gather, __m128i scatter, __m128i keep, __m128 brightness_rate_sse, int darken)
+{
+    __m128i block = _mm_loadu_si128((__m128i*)pixels);
+    __m128 current = _mm_cvtepi32_ps(_mm_shuffle_epi8(block, gather));
+
+    __m128 delta;
+    if (darken) delta = current;
+    else        delta = _mm_sub_ps(_mm_set1_ps(255.0f), current);
+
+    __m128 weigthed_delta = _mm_mul_ps(delta, brightness_rate_sse);
+    current = _mm_add_ps(weigthed_delta, current);
+
+    // narrow to bytes with saturation and put them back between h and s
+    __m128i v = _mm_cvttps_epi32(current);
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+
+    block = _mm_or_si128(_mm_and_si128(block, keep), _mm_shuffle_epi8(v, scatter));
+    _mm_storeu_si128((__m128i*)pixels, block);
+}
+
+// manipulating the brightnes of a bitmap (HSV) and speed it up with sse intrinsics
+// a single pass over the interleaved pixels, no buffer
+__attribute__((target("ssse3")))
+void manipulate_sse(bitmap_view_t *view, float brighten_rate)
+{
+    uint32_t width = view->widthPx;
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    int darken = brighten_rate < 0;
+
+    // constants for the intrinsics calculation
+    __m128i gather, scatter, keep;
+    v_shuffles(pixel_size, &gather, &scatter, &keep);
+    __m128 brightness_rate_sse = _mm_set1_ps(brighten_rate);
+
+    for (uint32_t y = 0; y < view->heightPx; y++) {
+        bitmap_component_t *row = bitmapViewRow(view, y);
+
+        // 4 pixels at once as long as 16 bytes fit into the row
+        uint32_t x = 0;
+        for (; x * pixel_size + 16 <= width * pixel_size; x += 4)
+            manipulate_block_sse(row + x * pixel_size, gather, scatter, keep, brightness_rate_sse, darken);
+
+        // the last pixels go through a copy on the stack (at most 5 packed ones)
+        if (x < width) {
+            bitmap_component_t tail[32] = { 0 };
+            memcpy(tail, row + x * pixel_size, (width - x) * pixel_size);
+
+            for (uint32_t i = 0; i < width - x; i += 4)
+                manipulate_block_sse(tail + i * pixel_size, gather, scatter, keep, brightness_rate_sse, darken);
+
+            memcpy(row + x * pixel_size, tail, (width - x) * pixel_size);
+        }
+    }
+}
+
+// manipulating the brightnes of a bitmap (HSV) and speed it up with avx-512 intrinsics (16 pixels at once)
+// the four 128 bit lanes hold 4 pixels each (like the halves of the avx2 kernel), a permutation of dwords moves them there and back
+// masked loads and byte stores: only the v bytes are written and the last pixels of a row need no extra pass
+__attribute__((target("avx512f,avx512bw")))
+void manipulate_avx512(bitmap_view_t *view, float brighten_rate)
+{
+    uint32_t width = view->widthPx;
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+    int darken = brighten_rate < 0;
+
+    // constants for the intrinsics calculation (the same shuffles in all lanes)
+    __m128i gather, scatter, keep;
+    v_shuffles(pixel_size, &gather, &scatter, &keep);
+
+    __m512i gather_avx = _mm512_broadcast_i32x4(gather);
+    __m512i scatter_avx = _mm512_broadcast_i32x4(scatter);
+    __m512 brightness_rate_avx = _mm512_set1_ps(brighten_rate);
+    __m512 v_max = _mm512_set1_ps(255.0f);
+
+    // lane k starts at pixel 4 * k: dword 4 * k resp. 3 * k (packed), the way back takes the first dwords of every lane
+    __m512i to_lanes, from_lanes;
+    __mmask64 v_bytes = 0;
+
+    if (pixel_size == 4) {
+        to_lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        from_lanes = to_lanes;
+    } else {
+        to_lanes = _mm512_set_epi32(12, 11, 10, 9, 9, 8, 7, 6, 6, 5, 4, 3, 3, 2, 1, 0);
+        from_lanes = _mm512_set_epi32(0, 0, 0, 0, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0);
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+        v_bytes |= (__mmask64)1 << (i * pixel_size + offsetof(bitmap_pixel_hsv_t, v));
+
+    for (uint32_t y = 0; y < view->heightPx; y++) {
+        bitmap_component_t *row = bitmapViewRow(view, y);
+
+        for (uint32_t x = 0; x < width; x += 16) {
+            // the bytes of the pixels that are left in the row
+            uint32_t bytes = MIN(16, width - x) * pixel_size;
+            __mmask64 row_bytes = (bytes == 64) ? ~(__mmask64)0 : ((__mmask64)1 << bytes) - 1;
+
+            bitmap_component_t *pixels = row + x * pixel_size;
+            __m512i block = _mm512_permutexvar_epi32(to_lanes, _mm512_maskz_loadu_epi8(row_bytes, pixels));
+            __m512 current = _mm512_cvtepi32_ps(_mm512_shuffle_epi8(block, gather_avx));
+
+            __m512 delta;
+            if (darken) delta = current;
+            else        delta = _mm512_sub_ps(v_max, current);
+
+            __m512 weigthed_delta = _mm512_mul_ps(delta, brightness_rate_avx);
+            current = _mm512_add_ps(weigthed_delta, current);
+
+            // narrow to bytes with saturation (in each lane), back to the v positions and only store those
+            __m512i v = _mm512_cvttps_epi32(current);
+            v = _mm512_packs_epi32(v, v);
+            v = _mm512_packus_epi16(v, v);
+            v = _mm512_permutexvar_epi32(from_lanes, _mm512_shuffle_epi8(v, scatter_avx));
+
+            _mm512_mask_storeu_epi8(pixels, v_bytes & row_bytes, v);
+        }
+    }
+}
+
+// manipulating the brightnes of a bitmap (HSV) one pixel at a time (for processors without ssse3 and for comparisons)
+void manipulate_scalar(bitmap_view_t *view, float brighten_rate)
+{
+    uint32_t pixel_size = bitmapPixelFormatSize(view->pixelFormat);
+
+    for (uint32_t y = 0; y < view->heightPx; y++) {
+        bitmap_component_t *v = bitmapViewRow(view, y) + offsetof(bitmap_pixel_hsv_t, v);
+
+        for (uint32_t x = 0; x < view->widthPx; x++, v += pixel_size) {
+            float current = (float)(*v);
+            float delta = (brighten_rate < 0) ? current : 255.0f - current;
+
+            float weigthed_delta = delta * brighten_rate;
+            current = weigthed_delta + current;
+
+            *v = (bitmap_component_t)MIN(255.0f, MAX(0.0f, current));
+        }
+    }
+}
+
+// all kernels, from the narrowest to the widest
+const manipulate_function_t kernels[] = { manipulate_scalar, manipulate_sse, manipulate_avx2, manipulate_avx512 };
+
+// selects the widest kernel that runs on this machine
+// the environment variable BRIGHTNESS_KERNEL (scalar, sse, avx2 or avx512) picks a narrower one, e.g. for benchmarks
+manipulate_function_t select_kernel()
+{
+    uint32_t kernel = supported_kernel();
+    char *requested = getenv("BRIGHTNESS_KERNEL");
+
+    if (requested != NULL) {
+        uint32_t index = 0;
+        while (index <= KERNEL_AVX512 && strcmp(requested, kernel_names[index]) != 0)
+            index++;
+
+        if (index > KERNEL_AVX512)
+            fprintf(stderr, "Unknown kernel %s, using %s.\n", requested, kernel_names[kernel]);
+        else if (index > kernel)
+            fprintf(stderr, "The %s kernel is not supported on this machine, using %s.\n", requested, kernel_names[kernel]);
+        else
+            kernel = index;
+    }
+
+    return kernels[kernel];
+}
+
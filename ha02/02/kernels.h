@@ -0,0 +1,36 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+
+#include "lib/bitmap.h"
+
+// the brightness kernels, from the narrowest to the widest
+#define KERNEL_SCALAR 0
+#define KERNEL_SSE 1
+#define KERNEL_AVX2 2
+#define KERNEL_AVX512 3
+
+// the names of the kernels (for the BRIGHTNESS_KERNEL environment variable)
+extern const char *kernel_names[];
+
+// a brightness kernel
+typedef void (*manipulate_function_t)(bitmap_view_t *view, float brighten_rate);
+
+// all kernels, from the narrowest to the widest (indexed by the KERNEL_ constants)
+extern const manipulate_function_t kernels[];
+
+// returns the widest kernel the processor supports and the operating system has enabled
+uint32_t supported_kernel();
+
+// the kernels: new_v = v + (255 - v) * brighten_rate (brighten_rate > 0) or v + v * brighten_rate (brighten_rate < 0) on hsv views of both pixel formats
+// all of them multiply and then add (two roundings, no fused multiply-add, see the Makefile), so they give the same bytes on every processor
+void manipulate_scalar(bitmap_view_t *view, float brighten_rate);
+void manipulate_sse(bitmap_view_t *view, float brighten_rate);
+void manipulate_avx2(bitmap_view_t *view, float brighten_rate);
+void manipulate_avx512(bitmap_view_t *view, float brighten_rate);
+
+// selects the widest kernel that runs on this machine (BRIGHTNESS_KERNEL picks a narrower one)
+manipulate_function_t select_kernel();
+
+#endif
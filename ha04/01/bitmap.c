@@ -1,3 +1,6 @@
+//We need O_DIRECT:
+#define _GNU_SOURCE
+
 #include "bitmap.h"
 
 //Min / max:
@@ -12,25 +15,73 @@
 #include <string.h>
 
 //Includes from POSIX:
+#include <fcntl.h>
 #include <unistd.h>
 
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+//Threads (if enabled):
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 //Constants:
 #define BITMAP_MAGIC_NUMBER 0x4D42
+#define BITMAP_FILE_HEADER_SIZE 14
+
+//Writing goes through an aligned staging buffer (a multiple of the alignment O_DIRECT needs):
+#define BITMAP_STAGING_ALIGNMENT 4096
+#define BITMAP_STAGING_BYTES (1024 * 1024)
 
 //The internal representation of a bitmap.
-typedef struct {
+typedef struct bitmap_s bitmap_t;
+
+//Row converters between the raw rows of the file and bitmap_pixel_t.
+//They are selected once per image, depending on the color depth and the color space.
+typedef void (*bitmap_read_row_t)(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow);
+typedef void (*bitmap_write_row_t)(bitmap_t* bitmap, const bitmap_pixel_t* rowData, uint8_t* outputRow);
+
+struct bitmap_s {
 	//The embedded bitmap parameters:
 	bitmap_parameters_t parameters;
 
-	//The file pointer:
+	//The file pointer (reading only):
 	FILE* file;
 
 	//Where do the pixels start?
 	uint32_t pixelOffset;
-} bitmap_t;
+
+	//The file descriptor (writing only):
+	int fd;
+
+	//Is the file descriptor opened with O_DIRECT?
+	bitmap_bool_t directIO;
+
+	//The staging buffer in front of the file descriptor and how much of it is used (writing only):
+	uint8_t* staging;
+	size_t stagingUsed;
+
+	//The final size of the file (writing only, known before the first byte is written):
+	uint32_t fileSize;
+
+	//Expansion tables for indexed bitmaps (reading only): Every possible byte maps to the pixels it encodes.
+	bitmap_pixel_t expand1[256][8];
+	bitmap_pixel_t expand4[256][2];
+
+	//A row of unpacked pixels, if the user does not provide BITMAP_PIXEL_FORMAT_32:
+	bitmap_pixel_t* pixelRow;
+
+	//The selected row converters:
+	bitmap_read_row_t readRow;
+	bitmap_write_row_t writeRow;
+};
 
 //Internal logging function based on BITMAP_LOGGING.
-//This always writes full lines.
+//This always writes full lines. They go to stderr, stdout might carry frames.
 void bitmapLog(bitmap_logging_t logging, const char* format, ...)
 {
 	//Check level:
@@ -39,12 +90,12 @@ void bitmapLog(bitmap_logging_t logging, const char* format, ...)
 		return;
 	}
 
-	//Delegate to vprintf:
+	//Delegate to vfprintf:
 	va_list args;
 	va_start(args, format);
 
-	vprintf(format, args);
-	printf("\n");
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
 
 	va_end(args);
 }
@@ -55,1795 +106,3146 @@ void bitmapLog(bitmap_logging_t logging, const char* format, ...)
 	Do we need FP? Not right now ...
 **********************************************************************************************************************************************************************/
 
-bitmap_pixel_rgb_t pixelToRGB(bitmap_pixel_t pixel, bitmap_color_space_t colorSpace)
+//Internal pixel converters for a single color space.
+//The row converters are generated from these (see below), so there is no switch over the color space per pixel.
+static inline bitmap_pixel_rgb_t pixelToRGB_RGB(bitmap_pixel_t pixel)
 {
 	bitmap_pixel_rgb_t newPixel;
 
-	switch (colorSpace)
-	{
-	case BITMAP_COLOR_SPACE_HSV:
-	{
-		newPixel.c3 = pixel.c3;
+	newPixel.r = pixel.c0;
+	newPixel.g = pixel.c1;
+	newPixel.b = pixel.c2;
+	newPixel.c3 = pixel.c3;
 
-		if (pixel.c1 == 0)
-		{
-			newPixel.r = pixel.c2;
-			newPixel.g = pixel.c2;
-			newPixel.b = pixel.c2;
+	return newPixel;
+}
 
-        	break;
-		}
+static inline bitmap_pixel_rgb_t pixelToRGB_HSV(bitmap_pixel_t pixel)
+{
+	bitmap_pixel_rgb_t newPixel;
 
-		bitmap_component_t region = pixel.c0 / 43;
-		bitmap_component_t remainder = (pixel.c0 - (region * 43)) * 6;
+	newPixel.c3 = pixel.c3;
 
-		bitmap_component_t p = (pixel.c2 * (255 - pixel.c1)) >> 8;
-		bitmap_component_t q = (pixel.c2 * (255 - ((pixel.c1 * remainder) >> 8))) >> 8;
-		bitmap_component_t t = (pixel.c2 * (255 - ((pixel.c1 * (255 - remainder)) >> 8))) >> 8;
+	if (pixel.c1 == 0)
+	{
+		newPixel.r = pixel.c2;
+		newPixel.g = pixel.c2;
+		newPixel.b = pixel.c2;
 
-		switch (region)
-		{
-		case 0:
+		return newPixel;
+	}
 
-			newPixel.r = pixel.c2;
-			newPixel.g = t;
-			newPixel.b = p;
+	bitmap_component_t region = pixel.c0 / 43;
+	bitmap_component_t remainder = (pixel.c0 - (region * 43)) * 6;
 
-			break;
+	bitmap_component_t p = (pixel.c2 * (255 - pixel.c1)) >> 8;
+	bitmap_component_t q = (pixel.c2 * (255 - ((pixel.c1 * remainder) >> 8))) >> 8;
+	bitmap_component_t t = (pixel.c2 * (255 - ((pixel.c1 * (255 - remainder)) >> 8))) >> 8;
 
-		case 1:
+	switch (region)
+	{
+	case 0:
 
-			newPixel.r = q;
-			newPixel.g = pixel.c2;
-			newPixel.b = p;
+		newPixel.r = pixel.c2;
+		newPixel.g = t;
+		newPixel.b = p;
 
-			break;
+		break;
 
-		case 2:
+	case 1:
 
-			newPixel.r = p;
-			newPixel.g = pixel.c2;
-			newPixel.b = t;
+		newPixel.r = q;
+		newPixel.g = pixel.c2;
+		newPixel.b = p;
 
-			break;
+		break;
 
-		case 3:
+	case 2:
 
-			newPixel.r = p;
-			newPixel.g = q;
-			newPixel.b = pixel.c2;
+		newPixel.r = p;
+		newPixel.g = pixel.c2;
+		newPixel.b = t;
 
-			break;
+		break;
 
-		case 4:
+	case 3:
 
-			newPixel.r = t;
-			newPixel.g = p;
-			newPixel.b = pixel.c2;
+		newPixel.r = p;
+		newPixel.g = q;
+		newPixel.b = pixel.c2;
 
-			break;
+		break;
 
-		default:
+	case 4:
 
-			newPixel.r = pixel.c2;
-			newPixel.g = p;
-			newPixel.b = q;
-		}
+		newPixel.r = t;
+		newPixel.g = p;
+		newPixel.b = pixel.c2;
 
 		break;
-	}
 
 	default:
 
-		//RGB:
-		newPixel.r = pixel.c0;
-		newPixel.g = pixel.c1;
-		newPixel.b = pixel.c2;
-		newPixel.c3 = pixel.c3;
+		newPixel.r = pixel.c2;
+		newPixel.g = p;
+		newPixel.b = q;
 	}
 
 	return newPixel;
 }
 
-bitmap_pixel_t rgbToPixel(bitmap_pixel_rgb_t pixel, bitmap_color_space_t colorSpace)
+static inline bitmap_pixel_t rgbToPixel_RGB(bitmap_pixel_rgb_t pixel)
 {
 	bitmap_pixel_t newPixel;
 
-	switch (colorSpace)
-	{
-	case BITMAP_COLOR_SPACE_HSV:
-	{
-		newPixel.c3 = pixel.c3;
-
-		bitmap_component_t rgbMin = BITMAP_MIN(pixel.r, BITMAP_MIN(pixel.g, pixel.b));
-		bitmap_component_t rgbMax = BITMAP_MAX(pixel.r, BITMAP_MAX(pixel.g, pixel.b));
+	newPixel.c0 = pixel.r;
+	newPixel.c1 = pixel.g;
+	newPixel.c2 = pixel.b;
+	newPixel.c3 = pixel.c3;
 
-		newPixel.c2 = rgbMax;
+	return newPixel;
+}
 
-		if (newPixel.c2 == 0)
-		{
-			newPixel.c0 = 0;
-			newPixel.c1 = 0;
+static inline bitmap_pixel_t rgbToPixel_HSV(bitmap_pixel_rgb_t pixel)
+{
+	bitmap_pixel_t newPixel;
 
-			break;
-		}
+	newPixel.c3 = pixel.c3;
 
-		newPixel.c1 = (bitmap_component_t)((255 * (uint16_t)(rgbMax - rgbMin)) / rgbMax);
+	bitmap_component_t rgbMin = BITMAP_MIN(pixel.r, BITMAP_MIN(pixel.g, pixel.b));
+	bitmap_component_t rgbMax = BITMAP_MAX(pixel.r, BITMAP_MAX(pixel.g, pixel.b));
 
-		if (newPixel.c1 == 0)
-		{
-			newPixel.c0 = 0;
-			break;
-		}
+	newPixel.c2 = rgbMax;
 
-		if (rgbMax == pixel.r)
-			newPixel.c0 = 0 + ((43 * (pixel.g - pixel.b)) / (rgbMax - rgbMin));
-		else if (rgbMax == pixel.g)
-			newPixel.c0 = 85 + ((43 * (pixel.b - pixel.r)) / (rgbMax - rgbMin));
-		else
-			newPixel.c0 = 171 + ((43 * (pixel.r - pixel.g)) / (rgbMax - rgbMin));
+	if (newPixel.c2 == 0)
+	{
+		newPixel.c0 = 0;
+		newPixel.c1 = 0;
 
-		break;
+		return newPixel;
 	}
 
-	default:
+	newPixel.c1 = (bitmap_component_t)((255 * (uint16_t)(rgbMax - rgbMin)) / rgbMax);
 
-		//RGB:
-		newPixel.c0 = pixel.r;
-		newPixel.c1 = pixel.g;
-		newPixel.c2 = pixel.b;
-		newPixel.c3 = pixel.c3;
+	if (newPixel.c1 == 0)
+	{
+		newPixel.c0 = 0;
+
+		return newPixel;
 	}
 
+	if (rgbMax == pixel.r)
+		newPixel.c0 = 0 + ((43 * (pixel.g - pixel.b)) / (rgbMax - rgbMin));
+	else if (rgbMax == pixel.g)
+		newPixel.c0 = 85 + ((43 * (pixel.b - pixel.r)) / (rgbMax - rgbMin));
+	else
+		newPixel.c0 = 171 + ((43 * (pixel.r - pixel.g)) / (rgbMax - rgbMin));
+
 	return newPixel;
 }
 
-/**********************************************************************************************************************************************************************
-	Reading
-**********************************************************************************************************************************************************************/
-
-//Internal reading function.
-//Always reads "count" bytes.
-//
-//Errors:
-//
-//- BITMAP_ERROR_IO  A read error has occurred. Includes unexpected EOF.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapReadBytes(FILE* file, uint8_t* buffer, size_t count)
+//Internal pixel converters for any color space (used for single pixels, like the color table).
+bitmap_pixel_rgb_t pixelToRGB(bitmap_pixel_t pixel, bitmap_color_space_t colorSpace)
 {
-	if (fread(buffer, 1, count, file) != count)
+	switch (colorSpace)
 	{
-		if (feof(file))
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: Unexpected end of file.");
-			return BITMAP_ERROR_IO;
-		}
+	case BITMAP_COLOR_SPACE_HSV:
 
-		int err = ferror(file);
+		return pixelToRGB_HSV(pixel);
 
-		if (err)
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: IO error (%d).", err);
-			return BITMAP_ERROR_IO;
-		}
+	default:
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: Unknown IO error.");
-		return BITMAP_ERROR_IO;
+		return pixelToRGB_RGB(pixel);
 	}
-
-	return BITMAP_ERROR_SUCCESS;
 }
 
-//Some typed functions with the same behavior:
-bitmap_error_t bitmapReadU8(FILE* file, uint8_t* value)
+bitmap_pixel_t rgbToPixel(bitmap_pixel_rgb_t pixel, bitmap_color_space_t colorSpace)
 {
-	return bitmapReadBytes(file, value, sizeof(uint8_t));
-}
+	switch (colorSpace)
+	{
+	case BITMAP_COLOR_SPACE_HSV:
 
-bitmap_error_t bitmapReadI8(FILE* file, int8_t* value)
-{
-	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int8_t));
+		return rgbToPixel_HSV(pixel);
+
+	default:
+
+		return rgbToPixel_RGB(pixel);
+	}
 }
 
-bitmap_error_t bitmapReadU16(FILE* file, uint16_t* value)
+/**********************************************************************************************************************************************************************
+	Views
+**********************************************************************************************************************************************************************/
+
+//User-accessible.
+uint32_t bitmapPixelFormatSize(bitmap_pixel_format_t pixelFormat)
 {
-	return bitmapReadBytes(file, (uint8_t*)value, sizeof(uint16_t));
+	switch (pixelFormat)
+	{
+	case BITMAP_PIXEL_FORMAT_32:
+
+		return sizeof(bitmap_pixel_t);
+
+	case BITMAP_PIXEL_FORMAT_24:
+
+		return sizeof(bitmap_pixel24_t);
+
+	default:
+
+		return 0;
+	}
 }
 
-bitmap_error_t bitmapReadI16(FILE* file, int16_t* value)
+//User-accessible.
+bitmap_view_t bitmapViewFromPixels(bitmap_pixel_t* pixels, uint32_t widthPx, uint32_t heightPx)
 {
-	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int16_t));
+	return bitmapViewFromBuffer(pixels, widthPx, heightPx, BITMAP_PIXEL_FORMAT_32);
 }
 
-bitmap_error_t bitmapReadU32(FILE* file, uint32_t* value)
+//User-accessible.
+bitmap_view_t bitmapViewFromBuffer(void* data, uint32_t widthPx, uint32_t heightPx, bitmap_pixel_format_t pixelFormat)
 {
-	return bitmapReadBytes(file, (uint8_t*)value, sizeof(uint32_t));
+	bitmap_view_t view;
+
+	view.data = (uint8_t*)data;
+	view.widthPx = widthPx;
+	view.heightPx = heightPx;
+	view.strideBytes = (int64_t)widthPx * bitmapPixelFormatSize(pixelFormat);
+	view.pixelFormat = pixelFormat;
+
+	return view;
 }
 
-bitmap_error_t bitmapReadI32(FILE* file, int32_t* value)
+//User-accessible.
+bitmap_view_t bitmapViewCrop(bitmap_view_t view, uint32_t xPx, uint32_t yPx, uint32_t widthPx, uint32_t heightPx)
 {
-	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int32_t));
+	//Clamp the rectangle:
+	xPx = BITMAP_MIN(xPx, view.widthPx);
+	yPx = BITMAP_MIN(yPx, view.heightPx);
+	widthPx = BITMAP_MIN(widthPx, view.widthPx - xPx);
+	heightPx = BITMAP_MIN(heightPx, view.heightPx - yPx);
+
+	//Move the origin, the stride stays the same:
+	view.data = bitmapViewRow(&view, yPx) + ((size_t)xPx * bitmapPixelFormatSize(view.pixelFormat));
+	view.widthPx = widthPx;
+	view.heightPx = heightPx;
+
+	return view;
 }
 
-//Internal pixel row read function (BITMAP_COLOR_DEPTH_1).
-//The buffers will not be released by this function.
-void bitmapReadRowColorDepth_1(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputData, uint32_t rowPx)
+//User-accessible.
+bitmap_view_t bitmapViewFlipVertical(bitmap_view_t view)
 {
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	uint32_t pixelsRead = 0;
-	size_t baseIndex = rowPx * widthPx;
-
-	do
+	if (view.heightPx)
 	{
-		uint32_t pixelsToRead = widthPx - pixelsRead;
+		view.data = bitmapViewRow(&view, view.heightPx - 1);
+	}
 
-		if (pixelsToRead > 8)
-		{
-			pixelsToRead = 8;
-		}
+	view.strideBytes = -view.strideBytes;
 
-		uint8_t currByte = rowData[pixelsRead / 8];
+	return view;
+}
 
-		for (uint32_t i = 0; i < pixelsToRead; i++)
-		{
-			outputData[baseIndex + pixelsRead + i] = (currByte & (1 << (7 - i))) ? bitmap->parameters.colorTable[1] : bitmap->parameters.colorTable[0];
-		}
+//User-accessible.
+bitmap_view_t bitmapViewSkipRows(bitmap_view_t view, uint32_t step)
+{
+	if (step > 1)
+	{
+		view.heightPx = (view.heightPx + step - 1) / step;
+		view.strideBytes *= step;
+	}
 
-		pixelsRead += pixelsToRead;
-	} while (pixelsRead < widthPx);
+	return view;
 }
 
-//Internal pixel row read function (BITMAP_COLOR_DEPTH_8).
-//The buffers will not be released by this function.
-void bitmapReadRowColorDepth_8(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputData, uint32_t rowPx)
+//User-accessible.
+uint8_t* bitmapViewRow(const bitmap_view_t* view, uint32_t rowPx)
 {
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	size_t baseIndex = rowPx * widthPx;
+	return view->data + ((int64_t)rowPx * view->strideBytes);
+}
 
-	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+/**********************************************************************************************************************************************************************
+	Converting pixel formats
+**********************************************************************************************************************************************************************/
+
+//User-accessible.
+void bitmapPackPixels(const bitmap_pixel_t* pixels, bitmap_pixel24_t* packed, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
 	{
-		outputData[baseIndex + colPx] = bitmap->parameters.colorTable[rowData[colPx]];
+		packed[i].c0 = pixels[i].c0;
+		packed[i].c1 = pixels[i].c1;
+		packed[i].c2 = pixels[i].c2;
 	}
 }
 
-//Internal pixel row read function (BITMAP_COLOR_DEPTH_24).
-//The buffers will not be released by this function.
-void bitmapReadRowColorDepth_24(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputData, uint32_t rowPx)
+//User-accessible.
+void bitmapUnpackPixels(const bitmap_pixel24_t* packed, bitmap_pixel_t* pixels, size_t count)
 {
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	bitmap_color_space_t colorSpace = bitmap->parameters.colorSpace;
-	size_t baseIndex = rowPx * widthPx;
-
-	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	for (size_t i = 0; i < count; i++)
 	{
-		bitmap_pixel_rgb_t currPixel;
-
-		currPixel.r = rowData[(3 * colPx) + 2];
-		currPixel.g = rowData[(3 * colPx) + 1];
-		currPixel.b = rowData[(3 * colPx) + 0];
-		currPixel.c3 = 0x00;
-
-		outputData[baseIndex + colPx] = rgbToPixel(currPixel, colorSpace);
+		pixels[i].c0 = packed[i].c0;
+		pixels[i].c1 = packed[i].c1;
+		pixels[i].c2 = packed[i].c2;
+		pixels[i].c3 = 0xFF;
 	}
 }
 
-//Internal pixel row read function (BITMAP_COLOR_DEPTH_32).
-//The buffers will not be released by this function.
-void bitmapReadRowColorDepth_32(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputData, uint32_t rowPx)
-{
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	bitmap_color_space_t colorSpace = bitmap->parameters.colorSpace;
-	size_t baseIndex = rowPx * widthPx;
+/**********************************************************************************************************************************************************************
+	Brightness
+**********************************************************************************************************************************************************************/
 
-	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+//Internal function that scales the first three components of the pixels [firstPx, widthPx) of a row (scalar).
+//ratios[V] is the factor for the pixels with the biggest component V, black the component of black pixels afterwards.
+void bitmapScaleBrightnessRow(uint8_t* row, uint32_t firstPx, uint32_t widthPx, uint32_t pixelSize, const float* ratios, float black)
+{
+	for (uint32_t colPx = firstPx; colPx < widthPx; colPx++)
 	{
-		bitmap_pixel_rgb_t currPixel;
-
-		currPixel.r = rowData[(4 * colPx) + 2];
-		currPixel.g = rowData[(4 * colPx) + 1];
-		currPixel.b = rowData[(4 * colPx) + 0];
-		currPixel.c3 = rowData[(4 * colPx) + 3];
+		uint8_t* pixel = &row[(size_t)colPx * pixelSize];
+		uint8_t value = BITMAP_MAX(pixel[0], BITMAP_MAX(pixel[1], pixel[2]));
+		float bias = 0.5f + ((value == 0) ? black : 0.0f);
 
-		outputData[baseIndex + colPx] = rgbToPixel(currPixel, colorSpace);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			pixel[c] = (uint8_t)BITMAP_MIN(255.0f, (pixel[c] * ratios[value]) + bias);
+		}
 	}
 }
 
-//Internal pixel read function (BITMAP_COMPRESSION_NONE).
-//If the function succeeds, the pixel pointer is valid.
-//
-//Errors:
-//- BITMAP_ERROR_IO                   An IO error has occurred.
-//- BITMAP_ERROR_MEMORY               Insufficient memory.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapReadPixelsCompression_None(bitmap_t* bitmap, bitmap_pixel_t** pixels)
+#ifdef BITMAP_X86
+//Internal function that scales the first three components of the pixels of a row (AVX2).
+//8 pixels at once: two halves of 4 pixels (the second one starts at pixel 4, so packed halves overlap), the same shuffles in both.
+//Returns the number of pixels done, the rest is left to the scalar function.
+__attribute__((target("avx2")))
+uint32_t bitmapScaleBrightnessRow_AVX2(uint8_t* row, uint32_t widthPx, uint32_t pixelSize, const float* ratios, float black)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_NONE ...");
-
-	//Get width and height:
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	uint32_t heightPx = bitmap->parameters.heightPx;
-	uint32_t totalPx = widthPx * heightPx;
+	//Component c of pixel i goes to the low byte of int lane i of the vector c, and back from byte 4 * c + i of the packed result:
+	uint8_t gather[3][16], scatter[16], keep[16];
 
-	//Allocate space for the pixels:
-	bitmap_pixel_t* outputData = (bitmap_pixel_t*)malloc(totalPx * sizeof(bitmap_pixel_t));
+	memset(gather, 0x80, sizeof(gather));
+	memset(scatter, 0x80, sizeof(scatter));
+	memset(keep, 0xFF, sizeof(keep));
 
-	if (!outputData)
+	for (uint32_t i = 0; i < 4; i++)
 	{
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating pixel buffer.");
-		return BITMAP_ERROR_MEMORY;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			uint32_t position = (i * pixelSize) + c;
+
+			gather[c][4 * i] = position;
+			scatter[position] = (4 * c) + i;
+			keep[position] = 0;
+		}
 	}
 
-	//How many bytes are in a row?
-	size_t bitsPerRow = bitmap->parameters.colorDepth * widthPx;
-	size_t bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
+	__m256i gather0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)gather[0]));
+	__m256i gather1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)gather[1]));
+	__m256i gather2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)gather[2]));
+	__m256i scatterAll = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)scatter));
+	__m256i keepAll = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)keep));
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bits / bytes per row: %zu / %zu", bitsPerRow, bytesPerRow);
+	__m256 half = _mm256_set1_ps(0.5f);
+	__m256 blackAll = _mm256_set1_ps(black);
+	__m256i zero = _mm256_setzero_si256();
 
-	//Allocate memory for a row:
-	uint8_t* rowData = (uint8_t*)malloc(bytesPerRow);
+	uint32_t colPx = 0;
 
-	if (!rowData)
+	for (; ((colPx + 4) * pixelSize) + 16 <= widthPx * pixelSize; colPx += 8)
 	{
-		//Free the pixel buffer:
-		free(outputData);
+		uint8_t* first = &row[(size_t)colPx * pixelSize];
+		uint8_t* second = first + (4 * pixelSize);
+		__m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)first)), _mm_loadu_si128((const __m128i*)second), 1);
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating row buffer.");
-		return BITMAP_ERROR_MEMORY;
-	}
+		__m256i c0 = _mm256_shuffle_epi8(block, gather0);
+		__m256i c1 = _mm256_shuffle_epi8(block, gather1);
+		__m256i c2 = _mm256_shuffle_epi8(block, gather2);
+		__m256i value = _mm256_max_epi32(c0, _mm256_max_epi32(c1, c2));
 
-	//Status var:
-	bitmap_error_t success;
+		//The factors of the 8 pixels, black pixels get the new value on top:
+		__m256 ratio = _mm256_i32gather_ps(ratios, value, sizeof(float));
+		__m256 bias = _mm256_add_ps(half, _mm256_and_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(value, zero)), blackAll));
 
-	//Read row by row:
-	for (uint32_t rowPx = 0; rowPx < heightPx; rowPx++)
-	{
-		//Read the row:
-		if ((success = bitmapReadBytes(bitmap->file, rowData, bytesPerRow)) != BITMAP_ERROR_SUCCESS)
-		{
-			break;
-		}
+		c0 = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(c0), ratio), bias));
+		c1 = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(c1), ratio), bias));
+		c2 = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(c2), ratio), bias));
 
-		//Parse it, depending on the color depth:
-		switch (bitmap->parameters.colorDepth)
-		{
-		case BITMAP_COLOR_DEPTH_1:
+		//Narrow with saturation (in each half) and put the components back:
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(c0, c1), _mm256_packs_epi32(c2, c2));
+		block = _mm256_or_si256(_mm256_and_si256(block, keepAll), _mm256_shuffle_epi8(packed, scatterAll));
 
-			bitmapReadRowColorDepth_1(bitmap, rowData, outputData, rowPx);
-			break;
+		//The second half is written last, it has the new pixel 4 of packed rows:
+		_mm_storeu_si128((__m128i*)first, _mm256_castsi256_si128(block));
+		_mm_storeu_si128((__m128i*)second, _mm256_extracti128_si256(block, 1));
+	}
 
-		case BITMAP_COLOR_DEPTH_8:
+	return colPx;
+}
+#endif
 
-			bitmapReadRowColorDepth_8(bitmap, rowData, outputData, rowPx);
-			break;
+//User-accessible.
+void bitmapScaleBrightness(const bitmap_view_t* view, const uint8_t* valueTable)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(view->pixelFormat);
 
-		case BITMAP_COLOR_DEPTH_24:
+	if (!pixelSize)
+	{
+		return;
+	}
 
-			bitmapReadRowColorDepth_24(bitmap, rowData, outputData, rowPx);
-			break;
+	//The factor for every value (black pixels have no factor, they turn gray):
+	float ratios[256];
+	float black = valueTable[0];
 
-		case BITMAP_COLOR_DEPTH_32:
+	ratios[0] = 0.0f;
 
-			bitmapReadRowColorDepth_32(bitmap, rowData, outputData, rowPx);
-			break;
+	for (uint32_t value = 1; value < 256; value++)
+	{
+		ratios[value] = (float)valueTable[value] / value;
+	}
 
-		default:
+#ifdef BITMAP_X86
+	bitmap_bool_t avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Color depth is not (yet) supported. Sorry!");
-			success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
+	for (uint32_t rowPx = 0; rowPx < view->heightPx; rowPx++)
+	{
+		uint8_t* row = bitmapViewRow(view, rowPx);
+		uint32_t colPx = 0;
 
-		//Check success:
-		if (success != BITMAP_ERROR_SUCCESS)
+#ifdef BITMAP_X86
+		if (avx2)
 		{
-			break;
+			colPx = bitmapScaleBrightnessRow_AVX2(row, view->widthPx, pixelSize, ratios, black);
 		}
+#endif
+
+		bitmapScaleBrightnessRow(row, colPx, view->widthPx, pixelSize, ratios, black);
 	}
+}
 
-	//If we were successful, we assign the pointers:
-	if (success == BITMAP_ERROR_SUCCESS)
-	{
-		*pixels = outputData;
-
-		//Finished!
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "All pixels have been decompressed.");
-	}
-	else
+//Internal function that counts the values of the pixels [firstPx, widthPx) of a row into 4 histograms (scalar, neighbouring pixels count into different ones).
+void bitmapValueHistogramRow(const uint8_t* row, uint32_t firstPx, uint32_t widthPx, uint32_t pixelSize, uint32_t componentMask, uint32_t (*counts)[256])
+{
+	for (uint32_t colPx = firstPx; colPx < widthPx; colPx++)
 	{
-		//Free the pixel buffer:
-		free(outputData);
-	}
+		const uint8_t* pixel = &row[(size_t)colPx * pixelSize];
+		uint8_t value = 0;
 
-	//Free the row data:
-	free(rowData);
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			if (componentMask & (1u << c))
+			{
+				value = BITMAP_MAX(value, pixel[c]);
+			}
+		}
 
-	return success;
+		counts[colPx & 3][value]++;
+	}
 }
 
-//Internal DIB header reading function (BITMAP_DIB_HEADER_INFO).
-//
-//Errors:
-//
-//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the DIB header. Or we don't support some feature.
-//- BITMAP_ERROR_IO                   A read error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapReadDIBHeader_Info(bitmap_t* bitmap)
+#ifdef BITMAP_X86
+//Internal function that counts the values of a row into 4 histograms (AVX2). Returns the number of pixels done.
+//8 pixels at once: the components in the mask go to the low bytes of the int lanes, their maximum is packed into 8 bytes and counted from a register.
+__attribute__((target("avx2")))
+uint32_t bitmapValueHistogramRow_AVX2(const uint8_t* row, uint32_t widthPx, uint32_t pixelSize, uint32_t componentMask, uint32_t (*counts)[256])
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to read DIB header (BITMAP_DIB_HEADER_INFO) ...");
-
-	//Status var:
-	bitmap_error_t success;
+	//Component c of pixel i goes to the low byte of int lane i (of a half) for every component in the mask:
+	__m256i gathers[4];
+	uint32_t components = 0;
 
-	//Read the width:
-	if ((success = bitmapReadU32(bitmap->file, &(bitmap->parameters.widthPx))) != BITMAP_ERROR_SUCCESS)
+	for (uint32_t c = 0; c < pixelSize; c++)
 	{
-		return success;
-	}
+		if (componentMask & (1u << c))
+		{
+			uint8_t gather[16];
+			memset(gather, 0x80, sizeof(gather));
 
-	//Read the height:
-	int32_t heightPx;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				gather[4 * i] = (i * pixelSize) + c;
+			}
 
-	if ((success = bitmapReadI32(bitmap->file, &heightPx)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
+			gathers[components++] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)gather));
+		}
 	}
 
-	//Top-Down or bottom-up?
-	if (heightPx > 0)
-	{
-		bitmap->parameters.bottomUp = 1;
-		bitmap->parameters.heightPx = (uint32_t)heightPx;
-	}
-	else
-	{
-		bitmap->parameters.bottomUp = 0;
-		bitmap->parameters.heightPx = (uint32_t)-heightPx;
-	}
+	//The low byte of every int, first into the low 4 bytes of each half, then both halves together:
+	const __m256i lowBytes = _mm256_setr_epi8(
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+	);
+	const __m256i joinHalves = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
 
-	//Check size:
-	if ((bitmap->parameters.widthPx == 0) || (bitmap->parameters.heightPx == 0))
+	uint32_t colPx = 0;
+
+	for (; ((colPx + 4) * pixelSize) + 16 <= widthPx * pixelSize; colPx += 8)
 	{
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Width and / or height in pixels is 0.");
-		return BITMAP_ERROR_INVALID_FILE_FORMAT;
-	}
+		const uint8_t* first = &row[(size_t)colPx * pixelSize];
+		__m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)first)), _mm_loadu_si128((const __m128i*)(first + (4 * pixelSize))), 1);
+		__m256i value = _mm256_shuffle_epi8(block, gathers[0]);
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap pixel dimensions: %u x %u (width x height)", bitmap->parameters.widthPx, bitmap->parameters.heightPx);
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bottom-up: %s", (bitmap->parameters.bottomUp ? "true" : "false"));
+		for (uint32_t c = 1; c < components; c++)
+		{
+			value = _mm256_max_epu8(value, _mm256_shuffle_epi8(block, gathers[c]));
+		}
 
-	//Read the biPlanes (ignored):
-	uint16_t biPlanes;
+		uint64_t values = (uint64_t)_mm_cvtsi128_si64(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(value, lowBytes), joinHalves)));
 
-	if ((success = bitmapReadU16(bitmap->file, &biPlanes)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
+		counts[0][values & 0xFF]++;
+		counts[1][(values >> 8) & 0xFF]++;
+		counts[2][(values >> 16) & 0xFF]++;
+		counts[3][(values >> 24) & 0xFF]++;
+		counts[0][(values >> 32) & 0xFF]++;
+		counts[1][(values >> 40) & 0xFF]++;
+		counts[2][(values >> 48) & 0xFF]++;
+		counts[3][values >> 56]++;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "BiPlanes: %u (ignored)", biPlanes);
+	return colPx;
+}
+#endif
 
-	if (biPlanes != 1)
-	{
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "... but shouldn't that be 1 ?!");
-	}
+//User-accessible.
+void bitmapValueHistogram(const bitmap_view_t* view, uint32_t componentMask, uint32_t* histogram)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(view->pixelFormat);
 
-	//Read the color depth:
-	if ((success = bitmapReadU16(bitmap->file, &(bitmap->parameters.colorDepth))) != BITMAP_ERROR_SUCCESS)
+	//Only the components of a pixel count:
+	componentMask &= (1u << pixelSize) - 1;
+
+	memset(histogram, 0, 256 * sizeof(uint32_t));
+
+	if (!componentMask)
 	{
-		return success;
+		return;
 	}
 
-	switch (bitmap->parameters.colorDepth)
-	{
-	case BITMAP_COLOR_DEPTH_1:
+#ifdef BITMAP_X86
+	bitmap_bool_t avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 2 indexed colors");
-		break;
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		uint32_t counts[4][256];
+		memset(counts, 0, sizeof(counts));
 
-	case BITMAP_COLOR_DEPTH_4:
+#ifdef _OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (uint32_t rowPx = 0; rowPx < view->heightPx; rowPx++)
+		{
+			const uint8_t* row = bitmapViewRow(view, rowPx);
+			uint32_t colPx = 0;
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 16 indexed colors");
-		break;
+#ifdef BITMAP_X86
+			if (avx2)
+			{
+				colPx = bitmapValueHistogramRow_AVX2(row, view->widthPx, pixelSize, componentMask, counts);
+			}
+#endif
 
-	case BITMAP_COLOR_DEPTH_8:
+			bitmapValueHistogramRow(row, colPx, view->widthPx, pixelSize, componentMask, counts);
+		}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 256 indexed colors");
-		break;
+		for (uint32_t value = 0; value < 256; value++)
+		{
+			uint32_t count = counts[0][value] + counts[1][value] + counts[2][value] + counts[3][value];
 
-	case BITMAP_COLOR_DEPTH_16:
+#ifdef _OPENMP
+			#pragma omp atomic
+#endif
+			histogram[value] += count;
+		}
+	}
+}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 16 bit");
-		break;
+//Internal function that prepares the conversion between the pixel format of the user and bitmap_pixel_t.
+//
+//Errors:
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The pixel format is not supported.
+//- BITMAP_ERROR_MEMORY               Insufficient memory.
+//
+//If the function succeeds, the pixel row must be released.
+bitmap_error_t bitmapAllocatePixelRow(bitmap_t* bitmap)
+{
+	bitmap->pixelRow = NULL;
 
-	case BITMAP_COLOR_DEPTH_24:
+	switch (bitmap->parameters.pixelFormat)
+	{
+	case BITMAP_PIXEL_FORMAT_32:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 24 bit");
-		break;
+		//Rows are converted in place, nothing to do:
+		return BITMAP_ERROR_SUCCESS;
 
-	case BITMAP_COLOR_DEPTH_32:
+	case BITMAP_PIXEL_FORMAT_24:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 32 bit");
 		break;
 
 	default:
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown color depth: %u bit", bitmap->parameters.colorDepth);
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Pixel format is not supported.");
 		return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	//Read the compression:
-	uint32_t rawCompression;
+	bitmap->pixelRow = (bitmap_pixel_t*)malloc((size_t)bitmap->parameters.widthPx * sizeof(bitmap_pixel_t));
 
-	if ((success = bitmapReadU32(bitmap->file, &rawCompression)) != BITMAP_ERROR_SUCCESS)
+	if (!bitmap->pixelRow)
 	{
-		return success;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating pixel row.");
+		return BITMAP_ERROR_MEMORY;
 	}
 
-	switch (rawCompression)
-	{
-	case 0:
-
-		bitmap->parameters.compression = BITMAP_COMPRESSION_NONE;
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: none");
-
-		break;
-
-	case 1:
+	return BITMAP_ERROR_SUCCESS;
+}
 
-		bitmap->parameters.compression = BITMAP_COMPRESSION_RLE;
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: RLE (8 bit)");
+/**********************************************************************************************************************************************************************
+	Reading
+**********************************************************************************************************************************************************************/
 
-		//Make sure this is valid:
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_8) || !(bitmap->parameters.bottomUp))
+//Internal reading function.
+//Always reads "count" bytes.
+//
+//Errors:
+//
+//- BITMAP_ERROR_IO  A read error has occurred. Includes unexpected EOF.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapReadBytes(FILE* file, uint8_t* buffer, size_t count)
+{
+	if (fread(buffer, 1, count, file) != count)
+	{
+		if (feof(file))
 		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: Unexpected end of file.");
+			return BITMAP_ERROR_IO;
 		}
 
-		break;
-
-	case 2:
-
-		bitmap->parameters.compression = BITMAP_COMPRESSION_RLE;
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: RLE (4 bit)");
+		int err = ferror(file);
 
-		//Make sure this is valid:
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_4) || !(bitmap->parameters.bottomUp))
+		if (err)
 		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: IO error (%d).", err);
+			return BITMAP_ERROR_IO;
 		}
 
-		break;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read bytes: Unknown IO error.");
+		return BITMAP_ERROR_IO;
+	}
 
-	case 3:
+	return BITMAP_ERROR_SUCCESS;
+}
 
-		bitmap->parameters.compression = BITMAP_COMPRESSION_BITFIELD_RGB;
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: Bitfield (RGB)");
+//Some typed functions with the same behavior:
+bitmap_error_t bitmapReadU8(FILE* file, uint8_t* value)
+{
+	return bitmapReadBytes(file, value, sizeof(uint8_t));
+}
 
-		//Make sure this is valid:
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
+bitmap_error_t bitmapReadI8(FILE* file, int8_t* value)
+{
+	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int8_t));
+}
 
-		break;
+bitmap_error_t bitmapReadU16(FILE* file, uint16_t* value)
+{
+	return bitmapReadBytes(file, (uint8_t*)value, sizeof(uint16_t));
+}
 
-	case 6:
+bitmap_error_t bitmapReadI16(FILE* file, int16_t* value)
+{
+	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int16_t));
+}
 
-		bitmap->parameters.compression = BITMAP_COMPRESSION_BITFIELD_ARGB;
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: Bitfield (ARGB)");
+bitmap_error_t bitmapReadU32(FILE* file, uint32_t* value)
+{
+	return bitmapReadBytes(file, (uint8_t*)value, sizeof(uint32_t));
+}
 
-		//Make sure this is valid:
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
+bitmap_error_t bitmapReadI32(FILE* file, int32_t* value)
+{
+	return bitmapReadBytes(file, (uint8_t*)value, sizeof(int32_t));
+}
 
-		break;
+//Internal function that builds the expansion tables of indexed bitmaps (BITMAP_COLOR_DEPTH_1 and BITMAP_COLOR_DEPTH_4).
+//With those, a whole byte of indices is expanded at once instead of bit by bit.
+void bitmapBuildExpansionTables(bitmap_t* bitmap)
+{
+	const bitmap_pixel_t* colorTable = bitmap->parameters.colorTable;
 
-	default:
+	for (uint32_t byte = 0; byte < 256; byte++)
+	{
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			bitmap->expand1[byte][i] = colorTable[(byte >> (7 - i)) & 0x01];
+		}
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown bitmap compression: %u", rawCompression);
-		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		bitmap->expand4[byte][0] = colorTable[byte >> 4];
+		bitmap->expand4[byte][1] = colorTable[byte & 0x0F];
 	}
+}
 
-	//Read the size of the pixel data (ignored):
-	uint32_t pixelDataSize;
+//Internal pixel row read function (BITMAP_COLOR_DEPTH_1).
+//The buffers will not be released by this function.
+void bitmapReadRowColorDepth_1(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow)
+{
+	uint32_t widthPx = bitmap->parameters.widthPx;
+	uint32_t fullBytes = widthPx / 8;
 
-	if ((success = bitmapReadU32(bitmap->file, &pixelDataSize)) != BITMAP_ERROR_SUCCESS)
+	//Every byte becomes 8 pixels (32 bytes) with a single copy:
+	for (uint32_t i = 0; i < fullBytes; i++)
 	{
-		return success;
+		memcpy(&outputRow[8 * i], bitmap->expand1[rowData[i]], 8 * sizeof(bitmap_pixel_t));
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Pixel data size in bytes: %u (ignored)", pixelDataSize);
-
-	//Read the pixels per meter (ignored):
-	uint32_t pixelsPerMeterX;
-
-	if ((success = bitmapReadU32(bitmap->file, &pixelsPerMeterX)) != BITMAP_ERROR_SUCCESS)
+	//The rest of the last byte:
+	if (widthPx % 8)
 	{
-		return success;
+		memcpy(&outputRow[8 * fullBytes], bitmap->expand1[rowData[fullBytes]], (widthPx % 8) * sizeof(bitmap_pixel_t));
 	}
+}
 
-	uint32_t pixelsPerMeterY;
+//Internal pixel row read function (BITMAP_COLOR_DEPTH_4).
+//The buffers will not be released by this function.
+void bitmapReadRowColorDepth_4(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow)
+{
+	uint32_t widthPx = bitmap->parameters.widthPx;
+	uint32_t fullBytes = widthPx / 2;
 
-	if ((success = bitmapReadU32(bitmap->file, &pixelsPerMeterY)) != BITMAP_ERROR_SUCCESS)
+	//Every byte becomes 2 pixels (8 bytes) with a single copy:
+	for (uint32_t i = 0; i < fullBytes; i++)
 	{
-		return success;
+		memcpy(&outputRow[2 * i], bitmap->expand4[rowData[i]], 2 * sizeof(bitmap_pixel_t));
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap destination resolution: %u p/m in X, %u p/m in Y (ignored)", pixelsPerMeterX, pixelsPerMeterY);
+	//The high nibble of the last byte:
+	if (widthPx % 2)
+	{
+		outputRow[2 * fullBytes] = bitmap->expand4[rowData[fullBytes]][0];
+	}
+}
 
-	//Read the number of valid color table entries:
-	uint32_t colorTableEntries;
+#ifdef BITMAP_X86
+//Internal pixel row read function (BITMAP_COLOR_DEPTH_8, AVX2).
+//Looks up 8 pixels at once with a gather from the color table.
+__attribute__((target("avx2")))
+void bitmapReadRowColorDepth_8_AVX2(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow)
+{
+	uint32_t widthPx = bitmap->parameters.widthPx;
+	const int* colorTable = (const int*)bitmap->parameters.colorTable;
+	uint32_t colPx = 0;
 
-	if ((success = bitmapReadU32(bitmap->file, &colorTableEntries)) != BITMAP_ERROR_SUCCESS)
+	for (; colPx + 8 <= widthPx; colPx += 8)
 	{
-		return success;
+		__m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&rowData[colPx]));
+		__m256i pixels = _mm256_i32gather_epi32(colorTable, indices, sizeof(bitmap_pixel_t));
+
+		_mm256_storeu_si256((__m256i*)&outputRow[colPx], pixels);
 	}
 
-	//Correct potential zeros:
-	if (colorTableEntries == 0)
+	for (; colPx < widthPx; colPx++)
 	{
-		switch (bitmap->parameters.colorDepth)
-		{
-		case BITMAP_COLOR_DEPTH_1:
+		outputRow[colPx] = bitmap->parameters.colorTable[rowData[colPx]];
+	}
+}
+#endif
 
-			colorTableEntries = 2;
-			break;
+//Internal pixel row read function (BITMAP_COLOR_DEPTH_8).
+//The buffers will not be released by this function.
+void bitmapReadRowColorDepth_8(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow)
+{
+	uint32_t widthPx = bitmap->parameters.widthPx;
 
-		case BITMAP_COLOR_DEPTH_4:
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	{
+		outputRow[colPx] = bitmap->parameters.colorTable[rowData[colPx]];
+	}
+}
 
-			colorTableEntries = 16;
-			break;
+//Generates the pixel row read function for a color depth with whole bytes per pixel (BITMAP_COLOR_DEPTH_24 / BITMAP_COLOR_DEPTH_32) and a color space.
+//Everything is known at compile time, so the inner loop has no branches.
+//The buffers will not be released by these functions.
+#define BITMAP_DEFINE_READ_ROW(colorDepth, colorSpace) \
+void bitmapReadRowColorDepth_##colorDepth##_##colorSpace(bitmap_t* bitmap, const uint8_t* rowData, bitmap_pixel_t* outputRow) \
+{ \
+	uint32_t widthPx = bitmap->parameters.widthPx; \
+	const uint32_t bytesPerPixel = (colorDepth) / 8; \
+\
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++) \
+	{ \
+		const uint8_t* rawPixel = &rowData[bytesPerPixel * colPx]; \
+		bitmap_pixel_rgb_t currPixel; \
+\
+		currPixel.r = rawPixel[2]; \
+		currPixel.g = rawPixel[1]; \
+		currPixel.b = rawPixel[0]; \
+		currPixel.c3 = (bytesPerPixel == 4) ? rawPixel[3] : 0xFF; \
+\
+		outputRow[colPx] = rgbToPixel_##colorSpace(currPixel); \
+	} \
+}
 
-		case BITMAP_COLOR_DEPTH_8:
+BITMAP_DEFINE_READ_ROW(24, RGB)
+BITMAP_DEFINE_READ_ROW(24, HSV)
+BITMAP_DEFINE_READ_ROW(32, RGB)
+BITMAP_DEFINE_READ_ROW(32, HSV)
 
-			colorTableEntries = 256;
-			break;
-		}
-	}
-	else
+//Internal function that selects the pixel row read function for the color depth and the color space.
+//Indexed bitmaps don't care about the color space, their color table is already converted.
+//
+//Errors:
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The color depth is not supported.
+bitmap_error_t bitmapSelectRowReader(bitmap_t* bitmap)
+{
+	bitmap_bool_t hsv = (bitmap->parameters.colorSpace == BITMAP_COLOR_SPACE_HSV);
+
+	switch (bitmap->parameters.colorDepth)
 	{
-		//Clamp the value if necessary:
-		if (colorTableEntries > 256)
+	case BITMAP_COLOR_DEPTH_1:
+
+		bitmap->readRow = bitmapReadRowColorDepth_1;
+		break;
+
+	case BITMAP_COLOR_DEPTH_4:
+
+		bitmap->readRow = bitmapReadRowColorDepth_4;
+		break;
+
+	case BITMAP_COLOR_DEPTH_8:
+
+		bitmap->readRow = bitmapReadRowColorDepth_8;
+
+#ifdef BITMAP_X86
+		if (__builtin_cpu_supports("avx2"))
 		{
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Clamping number of color table entries from %u to 256.", colorTableEntries);
-			colorTableEntries = 256;
+			bitmap->readRow = bitmapReadRowColorDepth_8_AVX2;
 		}
-	}
+#endif
 
-	bitmap->parameters.colorTableEntries = colorTableEntries;
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Color table entries: %u", bitmap->parameters.colorTableEntries);
+		break;
 
-	//Read the number of important color table entries (ignored):
-	uint32_t importantColorTableEntries;
+	case BITMAP_COLOR_DEPTH_24:
 
-	if ((success = bitmapReadU32(bitmap->file, &importantColorTableEntries)) != BITMAP_ERROR_SUCCESS)
+		bitmap->readRow = hsv ? bitmapReadRowColorDepth_24_HSV : bitmapReadRowColorDepth_24_RGB;
+		break;
+
+	case BITMAP_COLOR_DEPTH_32:
+
+		bitmap->readRow = hsv ? bitmapReadRowColorDepth_32_HSV : bitmapReadRowColorDepth_32_RGB;
+		break;
+
+	default:
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Color depth is not (yet) supported. Sorry!");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//Internal pixel row read function.
+//Parses one raw row (as stored in the file) into "outputRow" (in the pixel format of the user) with the selected row reader.
+void bitmapReadRow(bitmap_t* bitmap, const uint8_t* rowData, uint8_t* outputRow)
+{
+	if (!bitmap->pixelRow)
 	{
-		return success;
+		bitmap->readRow(bitmap, rowData, (bitmap_pixel_t*)outputRow);
+		return;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Important color table entries: %u (ignored)", importantColorTableEntries);
+	//Packed formats are parsed into the pixel row first:
+	bitmap->readRow(bitmap, rowData, bitmap->pixelRow);
+	bitmapPackPixels(bitmap->pixelRow, (bitmap_pixel24_t*)outputRow, bitmap->parameters.widthPx);
+}
 
-	//Depending on the compression, we have to read the bitmasks now:
-	if (bitmap->parameters.compression == BITMAP_COMPRESSION_BITFIELD_RGB)
+//Internal pixel read function (BITMAP_COMPRESSION_NONE).
+//If the function succeeds, the pixel pointer is valid.
+//
+//Errors:
+//- BITMAP_ERROR_IO                   An IO error has occurred.
+//- BITMAP_ERROR_MEMORY               Insufficient memory.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapReadPixelsCompression_None(bitmap_t* bitmap, uint8_t** pixels)
+{
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_NONE ...");
+
+	//Get width and height:
+	uint32_t widthPx = bitmap->parameters.widthPx;
+	uint32_t heightPx = bitmap->parameters.heightPx;
+	uint32_t totalPx = widthPx * heightPx;
+
+	//How many bytes are in a row of the output?
+	size_t pixelBytesPerRow = (size_t)widthPx * bitmapPixelFormatSize(bitmap->parameters.pixelFormat);
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Select the row reader, depending on the color depth and the color space:
+	if ((success = bitmapSelectRowReader(bitmap)) != BITMAP_ERROR_SUCCESS)
 	{
-		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&(bitmap->parameters.bitmasks), 3 * sizeof(uint32_t))) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+		return success;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "RGB bitmasks have been read.");
+	//Prepare the conversion into the pixel format of the user:
+	if ((success = bitmapAllocatePixelRow(bitmap)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
 	}
-	else if (bitmap->parameters.compression == BITMAP_COMPRESSION_BITFIELD_ARGB)
+
+	//Allocate space for the pixels:
+	uint8_t* outputData = (uint8_t*)malloc((size_t)totalPx * bitmapPixelFormatSize(bitmap->parameters.pixelFormat));
+
+	if (!outputData)
 	{
-		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&(bitmap->parameters.bitmasks), 4 * sizeof(uint32_t))) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+		//Free the pixel row:
+		free(bitmap->pixelRow);
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "ARGB bitmasks have been read.");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating pixel buffer.");
+		return BITMAP_ERROR_MEMORY;
 	}
-	else
+
+	//How many bytes are in a row?
+	size_t bitsPerRow = bitmap->parameters.colorDepth * widthPx;
+	size_t bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bits / bytes per row: %zu / %zu", bitsPerRow, bytesPerRow);
+
+	//Allocate memory for a row:
+	uint8_t* rowData = (uint8_t*)malloc(bytesPerRow);
+
+	if (!rowData)
 	{
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "No bitmasks have been read.");
+		//Free the pixel buffer and the pixel row:
+		free(outputData);
+		free(bitmap->pixelRow);
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating row buffer.");
+		return BITMAP_ERROR_MEMORY;
 	}
 
-	//Finally, read the color table:
-	if (bitmap->parameters.colorTableEntries)
+	//Read row by row:
+	for (uint32_t rowPx = 0; rowPx < heightPx; rowPx++)
 	{
-		bitmap_pixel_rgb_t colorTable[256];
-
-		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&colorTable, bitmap->parameters.colorTableEntries * sizeof(bitmap_pixel_rgb_t))) != BITMAP_ERROR_SUCCESS)
+		//Read the row:
+		if ((success = bitmapReadBytes(bitmap->file, rowData, bytesPerRow)) != BITMAP_ERROR_SUCCESS)
 		{
-			return success;
+			break;
 		}
 
-		//Now shuffle the table to the right order:
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color table (RGBA):");
-
-		for (uint32_t i = 0; i < bitmap->parameters.colorTableEntries; i++)
-		{
-			bitmap_pixel_rgb_t currPixel = colorTable[i];
-			bitmap_pixel_rgb_t newPixel;
-
-			newPixel.r = currPixel.b;
-			newPixel.g = currPixel.g;
-			newPixel.b = currPixel.r;
-			newPixel.c3 = currPixel.c3;
+		//Parse it:
+		bitmapReadRow(bitmap, rowData, &outputData[(size_t)rowPx * pixelBytesPerRow]);
+	}
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, " (0x%02X, 0x%02X, 0x%02X, 0x%02X)", newPixel.r, newPixel.g, newPixel.b, newPixel.c3);
+	//If we were successful, we assign the pointers:
+	if (success == BITMAP_ERROR_SUCCESS)
+	{
+		*pixels = outputData;
 
-			//Convert the pixel to our color space and insert it:
-			bitmap->parameters.colorTable[i] = rgbToPixel(newPixel, bitmap->parameters.colorSpace);
-		}
+		//Finished!
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "All pixels have been decompressed.");
 	}
 	else
 	{
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "No color table has been read.");
+		//Free the pixel buffer:
+		free(outputData);
 	}
 
-	//Okay, that worked :-)
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "DIB header (info) has successfully been read.");
+	//Free the row data and the pixel row:
+	free(rowData);
+	free(bitmap->pixelRow);
 
-	return BITMAP_ERROR_SUCCESS;
+	return success;
 }
 
-//Internal header reading function.
+//Internal DIB header reading function (BITMAP_DIB_HEADER_INFO).
 //
 //Errors:
 //
-//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the header. Or we don't support some feature.
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the DIB header. Or we don't support some feature.
 //- BITMAP_ERROR_IO                   A read error has occurred.
 //
 //The file will not be closed by this function.
-bitmap_error_t bitmapReadHeader(bitmap_t* bitmap)
+bitmap_error_t bitmapReadDIBHeader_Info(bitmap_t* bitmap)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to read header ...");
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to read DIB header (BITMAP_DIB_HEADER_INFO) ...");
 
 	//Status var:
 	bitmap_error_t success;
 
-	//Read and verify the magic number:
-	uint16_t magicNumber;
-
-	if ((success = bitmapReadU16(bitmap->file, &magicNumber)) != BITMAP_ERROR_SUCCESS)
+	//Read the width:
+	if ((success = bitmapReadU32(bitmap->file, &(bitmap->parameters.widthPx))) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	if (magicNumber != BITMAP_MAGIC_NUMBER)
+	//Read the height:
+	int32_t heightPx;
+
+	if ((success = bitmapReadI32(bitmap->file, &heightPx)) != BITMAP_ERROR_SUCCESS)
 	{
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Wrong magic number (0x%04X). This does not look like a bitmap.", magicNumber);
-		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		return success;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Magic number is a match.");
-
-	//Read and ignore the size in bytes:
-	uint32_t sizeInBytes;
+	//Top-Down or bottom-up?
+	if (heightPx > 0)
+	{
+		bitmap->parameters.bottomUp = 1;
+		bitmap->parameters.heightPx = (uint32_t)heightPx;
+	}
+	else
+	{
+		bitmap->parameters.bottomUp = 0;
+		bitmap->parameters.heightPx = (uint32_t)-heightPx;
+	}
 
-	if ((success = bitmapReadU32(bitmap->file, &sizeInBytes)) != BITMAP_ERROR_SUCCESS)
+	//Check size:
+	if ((bitmap->parameters.widthPx == 0) || (bitmap->parameters.heightPx == 0))
 	{
-		return success;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Width and / or height in pixels is 0.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Size in bytes: %u (ignored)", sizeInBytes);
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap pixel dimensions: %u x %u (width x height)", bitmap->parameters.widthPx, bitmap->parameters.heightPx);
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bottom-up: %s", (bitmap->parameters.bottomUp ? "true" : "false"));
 
-	//Read and ignore the writer-specific blob:
-	uint32_t writerSpecific;
+	//Read the biPlanes (ignored):
+	uint16_t biPlanes;
 
-	if ((success = bitmapReadU32(bitmap->file, &writerSpecific)) != BITMAP_ERROR_SUCCESS)
+	if ((success = bitmapReadU16(bitmap->file, &biPlanes)) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writer-specific blob: %u (ignored)", writerSpecific);
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "BiPlanes: %u (ignored)", biPlanes);
 
-	//Read the pixel offset:
-	if ((success = bitmapReadU32(bitmap->file, &(bitmap->pixelOffset))) != BITMAP_ERROR_SUCCESS)
+	if (biPlanes != 1)
 	{
-		return success;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "... but shouldn't that be 1 ?!");
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Pixel offset: 0x%04X", bitmap->pixelOffset);
-
-	//Read the size of the info header structure:
-	uint32_t infoHeaderSize;
-
-	if ((success = bitmapReadU32(bitmap->file, &infoHeaderSize)) != BITMAP_ERROR_SUCCESS)
+	//Read the color depth:
+	if ((success = bitmapReadU16(bitmap->file, &(bitmap->parameters.colorDepth))) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Info header size in bytes: %u", infoHeaderSize);
-
-	//The size tells us about the type.
+	switch (bitmap->parameters.colorDepth)
+	{
+	case BITMAP_COLOR_DEPTH_1:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 2 indexed colors");
+		break;
+
+	case BITMAP_COLOR_DEPTH_4:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 16 indexed colors");
+		break;
+
+	case BITMAP_COLOR_DEPTH_8:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 256 indexed colors");
+		break;
+
+	case BITMAP_COLOR_DEPTH_16:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 16 bit");
+		break;
+
+	case BITMAP_COLOR_DEPTH_24:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 24 bit");
+		break;
+
+	case BITMAP_COLOR_DEPTH_32:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color depth: 32 bit");
+		break;
+
+	default:
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown color depth: %u bit", bitmap->parameters.colorDepth);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Read the compression:
+	uint32_t rawCompression;
+
+	if ((success = bitmapReadU32(bitmap->file, &rawCompression)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	switch (rawCompression)
+	{
+	case 0:
+
+		bitmap->parameters.compression = BITMAP_COMPRESSION_NONE;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: none");
+
+		break;
+
+	case 1:
+
+		bitmap->parameters.compression = BITMAP_COMPRESSION_RLE;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: RLE (8 bit)");
+
+		//Make sure this is valid:
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_8) || !(bitmap->parameters.bottomUp))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		break;
+
+	case 2:
+
+		bitmap->parameters.compression = BITMAP_COMPRESSION_RLE;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: RLE (4 bit)");
+
+		//Make sure this is valid:
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_4) || !(bitmap->parameters.bottomUp))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		break;
+
+	case 3:
+
+		bitmap->parameters.compression = BITMAP_COMPRESSION_BITFIELD_RGB;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: Bitfield (RGB)");
+
+		//Make sure this is valid:
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		break;
+
+	case 6:
+
+		bitmap->parameters.compression = BITMAP_COMPRESSION_BITFIELD_ARGB;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compression: Bitfield (ARGB)");
+
+		//Make sure this is valid:
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		break;
+
+	default:
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown bitmap compression: %u", rawCompression);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Read the size of the pixel data (ignored):
+	uint32_t pixelDataSize;
+
+	if ((success = bitmapReadU32(bitmap->file, &pixelDataSize)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Pixel data size in bytes: %u (ignored)", pixelDataSize);
+
+	//Read the pixels per meter (ignored):
+	uint32_t pixelsPerMeterX;
+
+	if ((success = bitmapReadU32(bitmap->file, &pixelsPerMeterX)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	uint32_t pixelsPerMeterY;
+
+	if ((success = bitmapReadU32(bitmap->file, &pixelsPerMeterY)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap destination resolution: %u p/m in X, %u p/m in Y (ignored)", pixelsPerMeterX, pixelsPerMeterY);
+
+	//Read the number of valid color table entries:
+	uint32_t colorTableEntries;
+
+	if ((success = bitmapReadU32(bitmap->file, &colorTableEntries)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	//Correct potential zeros:
+	if (colorTableEntries == 0)
+	{
+		switch (bitmap->parameters.colorDepth)
+		{
+		case BITMAP_COLOR_DEPTH_1:
+
+			colorTableEntries = 2;
+			break;
+
+		case BITMAP_COLOR_DEPTH_4:
+
+			colorTableEntries = 16;
+			break;
+
+		case BITMAP_COLOR_DEPTH_8:
+
+			colorTableEntries = 256;
+			break;
+		}
+	}
+	else
+	{
+		//Clamp the value if necessary:
+		if (colorTableEntries > 256)
+		{
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Clamping number of color table entries from %u to 256.", colorTableEntries);
+			colorTableEntries = 256;
+		}
+	}
+
+	bitmap->parameters.colorTableEntries = colorTableEntries;
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Color table entries: %u", bitmap->parameters.colorTableEntries);
+
+	//Read the number of important color table entries (ignored):
+	uint32_t importantColorTableEntries;
+
+	if ((success = bitmapReadU32(bitmap->file, &importantColorTableEntries)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Important color table entries: %u (ignored)", importantColorTableEntries);
+
+	//Depending on the compression, we have to read the bitmasks now:
+	if (bitmap->parameters.compression == BITMAP_COMPRESSION_BITFIELD_RGB)
+	{
+		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&(bitmap->parameters.bitmasks), 3 * sizeof(uint32_t))) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "RGB bitmasks have been read.");
+	}
+	else if (bitmap->parameters.compression == BITMAP_COMPRESSION_BITFIELD_ARGB)
+	{
+		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&(bitmap->parameters.bitmasks), 4 * sizeof(uint32_t))) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "ARGB bitmasks have been read.");
+	}
+	else
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "No bitmasks have been read.");
+	}
+
+	//Finally, read the color table:
+	if (bitmap->parameters.colorTableEntries)
+	{
+		bitmap_pixel_rgb_t colorTable[256];
+
+		if ((success = bitmapReadBytes(bitmap->file, (uint8_t*)&colorTable, bitmap->parameters.colorTableEntries * sizeof(bitmap_pixel_rgb_t))) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
+
+		//Now shuffle the table to the right order:
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Color table (RGBA):");
+
+		for (uint32_t i = 0; i < bitmap->parameters.colorTableEntries; i++)
+		{
+			bitmap_pixel_rgb_t currPixel = colorTable[i];
+			bitmap_pixel_rgb_t newPixel;
+
+			newPixel.r = currPixel.b;
+			newPixel.g = currPixel.g;
+			newPixel.b = currPixel.r;
+			newPixel.c3 = 0xFF;
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, " (0x%02X, 0x%02X, 0x%02X, 0x%02X)", newPixel.r, newPixel.g, newPixel.b, newPixel.c3);
+
+			//Convert the pixel to our color space and insert it:
+			bitmap->parameters.colorTable[i] = rgbToPixel(newPixel, bitmap->parameters.colorSpace);
+		}
+	}
+	else
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "No color table has been read.");
+	}
+
+	//Indexed bitmaps are expanded a byte at a time:
+	if ((bitmap->parameters.colorDepth == BITMAP_COLOR_DEPTH_1) || (bitmap->parameters.colorDepth == BITMAP_COLOR_DEPTH_4))
+	{
+		bitmapBuildExpansionTables(bitmap);
+	}
+
+	//Okay, that worked :-)
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "DIB header (info) has successfully been read.");
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//Internal header reading function.
+//
+//Errors:
+//
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the header. Or we don't support some feature.
+//- BITMAP_ERROR_IO                   A read error has occurred.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapReadHeader(bitmap_t* bitmap)
+{
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to read header ...");
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Read and verify the magic number:
+	uint16_t magicNumber;
+
+	if ((success = bitmapReadU16(bitmap->file, &magicNumber)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	if (magicNumber != BITMAP_MAGIC_NUMBER)
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Wrong magic number (0x%04X). This does not look like a bitmap.", magicNumber);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Magic number is a match.");
+
+	//Read and ignore the size in bytes:
+	uint32_t sizeInBytes;
+
+	if ((success = bitmapReadU32(bitmap->file, &sizeInBytes)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Size in bytes: %u (ignored)", sizeInBytes);
+
+	//Read and ignore the writer-specific blob:
+	uint32_t writerSpecific;
+
+	if ((success = bitmapReadU32(bitmap->file, &writerSpecific)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writer-specific blob: %u (ignored)", writerSpecific);
+
+	//Read the pixel offset:
+	if ((success = bitmapReadU32(bitmap->file, &(bitmap->pixelOffset))) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Pixel offset: 0x%04X", bitmap->pixelOffset);
+
+	//Read the size of the info header structure:
+	uint32_t infoHeaderSize;
+
+	if ((success = bitmapReadU32(bitmap->file, &infoHeaderSize)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Info header size in bytes: %u", infoHeaderSize);
+
+	//The size tells us about the type.
 	switch (infoHeaderSize)
 	{
-		case BITMAP_DIB_HEADER_CORE_OS2_1X:
+		case BITMAP_DIB_HEADER_CORE_OS2_1X:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_CORE_OS2_1X");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		case BITMAP_DIB_HEADER_OS2_2X:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_OS2_2X");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		case BITMAP_DIB_HEADER_OS2_2X_SHORT:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_OS2_2X_SHORT");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+        case BITMAP_DIB_HEADER_INFO_V5:
+
+            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V5");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V4 ...");
+            /* fall through */
+
+        case BITMAP_DIB_HEADER_INFO_V4:
+
+            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V4");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V3 ...");
+            /* fall through */
+
+        case BITMAP_DIB_HEADER_INFO_V3:
+
+            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V3");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V2 ...");
+            /* fall through */
+
+        case BITMAP_DIB_HEADER_INFO_V2:
+
+            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V2");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
+            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V1 ...");
+            /* fall through */
+
+		case BITMAP_DIB_HEADER_INFO:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO");
+
+			if ((success = bitmapReadDIBHeader_Info(bitmap)))
+			{
+				return success;
+			}
+
+			break;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is unknown.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//That's it:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap header parsing has succeeded!");
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//Internal file open function.
+//If the function succeeds, the file pointer in the bitmap struct is valid.
+//
+//Errors:
+//- BITMAP_ERROR_INVALID_PATH         The given path is not valid in any way (missing file, bad permissions etc.).
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The given file is no valid bitmap.
+//- BITMAP_ERROR_IO                   An IO error has occurred.
+//- BITMAP_ERROR_MEMORY               Insufficient memory.
+//
+bitmap_error_t bitmapOpenFile(bitmap_t* bitmap, const char* filePath)
+{
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Going to open file \"%s\" ...", filePath);
+
+	//Try to open the file:
+	FILE* file = fopen(filePath, "rb");
+
+	if (!file)
+	{
+		switch (errno)
+		{
+		case ENOENT:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "File path to \"%s\" is invalid.", filePath);
+			return BITMAP_ERROR_INVALID_PATH;
+
+		case ENOMEM:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for opening file.");
+			return BITMAP_ERROR_MEMORY;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error opening file at \"%s\": %s", filePath, strerror(errno));
+			return BITMAP_ERROR_INVALID_PATH;
+		}
+	}
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "File has been opened successfully.");
+
+	//Set file pointer:
+	bitmap->file = file;
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//User-accessible.
+bitmap_error_t bitmapReadPixels(const char* filePath, bitmap_pixel_t** pixels, uint32_t* widthPx, uint32_t* heightPx, bitmap_color_space_t colorSpace)
+{
+	//A contiguous buffer is just the simplest view:
+	bitmap_view_t view;
+	bitmap_error_t success = bitmapReadView(filePath, &view, colorSpace, BITMAP_PIXEL_FORMAT_32);
+
+	*pixels = (bitmap_pixel_t*)view.data;
+	*widthPx = view.widthPx;
+	*heightPx = view.heightPx;
+
+	return success;
+}
+
+//User-accessible.
+bitmap_error_t bitmapReadView(const char* filePath, bitmap_view_t* view, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat)
+{
+	//NULL the view:
+	*view = bitmapViewFromBuffer(NULL, 0, 0, pixelFormat);
+
+	//Init a bitmap struct:
+	bitmap_t bitmap;
+	memset(&bitmap, 0, sizeof(bitmap_t));
+
+	//Assign our color space and pixel format:
+	bitmap.parameters.colorSpace = colorSpace;
+	bitmap.parameters.pixelFormat = pixelFormat;
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Open the bitmap file for reading:
+	if ((success = bitmapOpenFile(&bitmap, filePath)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_CORE_OS2_1X");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+	//Read the bitmap header:
+	if ((success = bitmapReadHeader(&bitmap)) != BITMAP_ERROR_SUCCESS)
+	{
+		//Close the file:
+		fclose(bitmap.file);
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		return success;
+	}
 
-		case BITMAP_DIB_HEADER_OS2_2X:
+	//Jump to the pixel offset:
+	fseek(bitmap.file, bitmap.pixelOffset, SEEK_SET);
+	int err = ferror(bitmap.file);
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_OS2_2X");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+	if (err)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek pixel offset: IO error (%d).", err);
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		//Close the file:
+		fclose(bitmap.file);
 
-		case BITMAP_DIB_HEADER_OS2_2X_SHORT:
+		return BITMAP_ERROR_IO;
+	}
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_OS2_2X_SHORT");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+	//Switch over the compression.
+	//Only BITMAP_COMPRESSION_NONE for the moment.
+	switch (bitmap.parameters.compression)
+	{
+	case BITMAP_COMPRESSION_NONE:
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		success = bitmapReadPixelsCompression_None(&bitmap, &(view->data));
+		break;
 
-        case BITMAP_DIB_HEADER_INFO_V5:
+	case BITMAP_COMPRESSION_RLE:
 
-            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V5");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V4 ...");
-            /* fall through */
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_RLE ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
-        case BITMAP_DIB_HEADER_INFO_V4:
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+		break;
 
-            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V4");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V3 ...");
-            /* fall through */
+	case BITMAP_COMPRESSION_BITFIELD_RGB:
 
-        case BITMAP_DIB_HEADER_INFO_V3:
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_BITFIELD_RGB ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
-            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V3");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V2 ...");
-            /* fall through */
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+		break;
 
-        case BITMAP_DIB_HEADER_INFO_V2:
+	case BITMAP_COMPRESSION_BITFIELD_ARGB:
 
-            bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO_V2");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported.");
-            bitmapLog(BITMAP_LOGGING_DEFAULT, "Trying fallback to V1 ...");
-            /* fall through */
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_BITFIELD_ARGB ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
-		case BITMAP_DIB_HEADER_INFO:
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+		break;
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO");
+	default:
 
-			if ((success = bitmapReadDIBHeader_Info(bitmap)))
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown compression scheme.");
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		break;
+	}
+
+	//Close the file:
+	fclose(bitmap.file);
+
+	//If that has worked, we can set the dimensions now.
+	if (success == BITMAP_ERROR_SUCCESS)
+	{
+		*view = bitmapViewFromBuffer(view->data, bitmap.parameters.widthPx, bitmap.parameters.heightPx, pixelFormat);
+	}
+
+	return success;
+}
+
+/**********************************************************************************************************************************************************************
+	Writing
+**********************************************************************************************************************************************************************/
+
+//Internal function that writes straight to the file descriptor.
+//Always writes "count" bytes.
+//
+//Errors:
+//
+//- BITMAP_ERROR_IO  A write error has occurred.
+bitmap_error_t bitmapWriteFileDescriptor(int fd, const uint8_t* buffer, size_t count)
+{
+	while (count)
+	{
+		ssize_t written = write(fd, buffer, count);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
 			{
-				return success;
+				continue;
 			}
 
-			break;
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to write bytes: IO error (%s).", strerror(errno));
+			return BITMAP_ERROR_IO;
+		}
 
-		default:
+		buffer += written;
+		count -= (size_t)written;
+	}
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is unknown.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//Internal writing function.
+//Always writes "count" bytes into the staging buffer, which is written out whenever it is full.
+//Full staging buffers are aligned in memory and in the file, so they can go through O_DIRECT.
+//
+//Errors:
+//
+//- BITMAP_ERROR_IO  A write error has occurred.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapWriteBytes(bitmap_t* bitmap, const uint8_t* buffer, size_t count)
+{
+	//Status var:
+	bitmap_error_t success;
+
+	while (count)
+	{
+		size_t chunk = BITMAP_MIN(count, BITMAP_STAGING_BYTES - bitmap->stagingUsed);
+
+		memcpy(bitmap->staging + bitmap->stagingUsed, buffer, chunk);
+
+		bitmap->stagingUsed += chunk;
+		buffer += chunk;
+		count -= chunk;
+
+		if (bitmap->stagingUsed == BITMAP_STAGING_BYTES)
+		{
+			if ((success = bitmapWriteFileDescriptor(bitmap->fd, bitmap->staging, BITMAP_STAGING_BYTES)) != BITMAP_ERROR_SUCCESS)
+			{
+				return success;
+			}
+
+			bitmap->stagingUsed = 0;
+		}
 	}
 
-	//That's it:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap header parsing has succeeded!");
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//Some typed functions with the same behavior:
+bitmap_error_t bitmapWriteU8(bitmap_t* bitmap, uint8_t value)
+{
+	return bitmapWriteBytes(bitmap, &value, sizeof(uint8_t));
+}
+
+bitmap_error_t bitmapWriteI8(bitmap_t* bitmap, int8_t value)
+{
+	return bitmapWriteBytes(bitmap, (uint8_t*)&value, sizeof(int8_t));
+}
+
+bitmap_error_t bitmapWriteU16(bitmap_t* bitmap, uint16_t value)
+{
+	return bitmapWriteBytes(bitmap, (uint8_t*)&value, sizeof(uint16_t));
+}
+
+bitmap_error_t bitmapWriteI16(bitmap_t* bitmap, int16_t value)
+{
+	return bitmapWriteBytes(bitmap, (uint8_t*)&value, sizeof(int16_t));
+}
+
+bitmap_error_t bitmapWriteU32(bitmap_t* bitmap, uint32_t value)
+{
+	return bitmapWriteBytes(bitmap, (uint8_t*)&value, sizeof(uint32_t));
+}
+
+bitmap_error_t bitmapWriteI32(bitmap_t* bitmap, int32_t value)
+{
+	return bitmapWriteBytes(bitmap, (uint8_t*)&value, sizeof(int32_t));
+}
+
+//Generates the pixel row writing function for a color depth with whole bytes per pixel (BITMAP_COLOR_DEPTH_24 / BITMAP_COLOR_DEPTH_32) and a color space.
+//Everything is known at compile time, so the inner loop has no branches.
+//The buffers will not be released by these functions.
+#define BITMAP_DEFINE_WRITE_ROW(colorDepth, colorSpace) \
+void bitmapWriteRowColorDepth_##colorDepth##_##colorSpace(bitmap_t* bitmap, const bitmap_pixel_t* rowData, uint8_t* outputRow) \
+{ \
+	uint32_t widthPx = bitmap->parameters.widthPx; \
+	const uint32_t bytesPerPixel = (colorDepth) / 8; \
+\
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++) \
+	{ \
+		uint8_t* rawPixel = &outputRow[bytesPerPixel * colPx]; \
+		bitmap_pixel_rgb_t currPixel = pixelToRGB_##colorSpace(rowData[colPx]); \
+\
+		rawPixel[0] = currPixel.b; \
+		rawPixel[1] = currPixel.g; \
+		rawPixel[2] = currPixel.r; \
+\
+		if (bytesPerPixel == 4) \
+		{ \
+			rawPixel[3] = currPixel.c3; \
+		} \
+	} \
+}
+
+BITMAP_DEFINE_WRITE_ROW(24, RGB)
+BITMAP_DEFINE_WRITE_ROW(24, HSV)
+BITMAP_DEFINE_WRITE_ROW(32, RGB)
+BITMAP_DEFINE_WRITE_ROW(32, HSV)
+
+//Internal function that selects the pixel row writing function for the color depth and the color space.
+//
+//Errors:
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The color depth is not supported.
+bitmap_error_t bitmapSelectRowWriter(bitmap_t* bitmap)
+{
+	bitmap_bool_t hsv = (bitmap->parameters.colorSpace == BITMAP_COLOR_SPACE_HSV);
+
+	switch (bitmap->parameters.colorDepth)
+	{
+	case BITMAP_COLOR_DEPTH_24:
+
+		bitmap->writeRow = hsv ? bitmapWriteRowColorDepth_24_HSV : bitmapWriteRowColorDepth_24_RGB;
+		break;
+
+	case BITMAP_COLOR_DEPTH_32:
+
+		//Note: Never padded!
+		bitmap->writeRow = hsv ? bitmapWriteRowColorDepth_32_HSV : bitmapWriteRowColorDepth_32_RGB;
+		break;
+
+	default:
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Color depth is not (yet) supported. Sorry!");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
 	return BITMAP_ERROR_SUCCESS;
 }
 
-//Internal file open function.
-//If the function succeeds, the file pointer in the bitmap struct is valid.
+//Internal pixel row writing function.
+//Encodes one row of pixels (in the pixel format of the user) into "outputRow" (bytesPerRow bytes, including padding) with the selected row writer, and writes it.
 //
 //Errors:
-//- BITMAP_ERROR_INVALID_PATH         The given path is not valid in any way (missing file, bad permissions etc.).
-//- BITMAP_ERROR_INVALID_FILE_FORMAT  The given file is no valid bitmap.
+//- BITMAP_ERROR_IO  An IO error has occurred.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapWriteRow(bitmap_t* bitmap, const uint8_t* rowData, uint8_t* outputRow, size_t bytesPerRow)
+{
+	//Packed formats are unpacked into the pixel row first:
+	const bitmap_pixel_t* pixelRow = (const bitmap_pixel_t*)rowData;
+
+	if (bitmap->pixelRow)
+	{
+		bitmapUnpackPixels((const bitmap_pixel24_t*)rowData, bitmap->pixelRow, bitmap->parameters.widthPx);
+		pixelRow = bitmap->pixelRow;
+	}
+
+	bitmap->writeRow(bitmap, pixelRow, outputRow);
+
+	return bitmapWriteBytes(bitmap, outputRow, bytesPerRow);
+}
+
+//How many bytes of pixels should a band have (bitmapWriteBands(...) only)?
+//The band should still be in the L2 cache when it is encoded after filling it.
+#define BITMAP_WRITE_BAND_BYTES (256 * 1024)
+
+//Internal pixel writing function (BITMAP_COMPRESSION_NONE).
+//The rows come from the view, or (if there is a row callback) from bands that are filled by the callback.
+//
+//Errors:
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The color depth is not supported.
 //- BITMAP_ERROR_IO                   An IO error has occurred.
 //- BITMAP_ERROR_MEMORY               Insufficient memory.
+//- Any error returned by the row callback.
 //
-bitmap_error_t bitmapOpenFile(bitmap_t* bitmap, const char* filePath)
+//The file will not be closed by this function.
+bitmap_error_t bitmapWritePixelsCompression_None(bitmap_t* bitmap, const bitmap_view_t* view, bitmap_row_callback_t rowCallback, void* userData)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Going to open file \"%s\" ...", filePath);
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_NONE ...");
 
-	//Try to open the file:
-	FILE* file = fopen(filePath, "rb");
+	//Get width and height:
+	uint32_t widthPx = bitmap->parameters.widthPx;
+	uint32_t heightPx = bitmap->parameters.heightPx;
 
-	if (!file)
+	//How many bytes are in a row?
+	size_t bitsPerRow = bitmap->parameters.colorDepth * widthPx;
+	size_t bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bits / bytes per row: %zu / %zu", bitsPerRow, bytesPerRow);
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Select the row writer, depending on the color depth and the color space:
+	if ((success = bitmapSelectRowWriter(bitmap)) != BITMAP_ERROR_SUCCESS)
 	{
-		switch (errno)
-		{
-		case ENOENT:
+		return success;
+	}
+
+	//Prepare the conversion from the pixel format of the user:
+	if ((success = bitmapAllocatePixelRow(bitmap)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	//Without a row callback, the whole view is a single band:
+	bitmap_view_t source = view ? *view : bitmapViewFromBuffer(NULL, widthPx, 0, bitmap->parameters.pixelFormat);
+	uint32_t bandRows = heightPx;
+	uint8_t* band = NULL;
+
+	if (rowCallback)
+	{
+		//How many rows fit into a band (a multiple of 8, so blocks and tiles do not straddle bands)?
+		size_t pixelBytesPerRow = (size_t)widthPx * bitmapPixelFormatSize(bitmap->parameters.pixelFormat);
+
+		bandRows = (uint32_t)BITMAP_MAX(8, ((BITMAP_WRITE_BAND_BYTES / pixelBytesPerRow) / 8) * 8);
+		bandRows = BITMAP_MIN(bandRows, heightPx);
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing in bands of %u rows ...", bandRows);
+
+		band = (uint8_t*)malloc((size_t)bandRows * pixelBytesPerRow);
+		source = bitmapViewFromBuffer(band, widthPx, bandRows, bitmap->parameters.pixelFormat);
+	}
+
+	//Allocate memory for a row (zeroed, so the padding is zero):
+	uint8_t* outputRow = (uint8_t*)calloc(bytesPerRow, 1);
+
+	if (!outputRow || (rowCallback && !band))
+	{
+		//Free the band and the pixel row:
+		free(outputRow);
+		free(band);
+		free(bitmap->pixelRow);
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "File path to \"%s\" is invalid.", filePath);
-			return BITMAP_ERROR_INVALID_PATH;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating row buffer.");
+		return BITMAP_ERROR_MEMORY;
+	}
 
-		case ENOMEM:
+	//Write band by band:
+	success = BITMAP_ERROR_SUCCESS;
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for opening file.");
-			return BITMAP_ERROR_MEMORY;
+	for (uint32_t firstRowPx = 0; (firstRowPx < heightPx) && (success == BITMAP_ERROR_SUCCESS); firstRowPx += bandRows)
+	{
+		uint32_t rows = BITMAP_MIN(bandRows, heightPx - firstRowPx);
 
-		default:
+		//Let the callback fill the band (a failed band is not written, and neither are the ones after it):
+		if (rowCallback)
+		{
+			bitmap_view_t bandView = bitmapViewCrop(source, 0, 0, widthPx, rows);
+			success = rowCallback(&bandView, firstRowPx, userData);
+		}
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error opening file at \"%s\": %s", filePath, strerror(errno));
-			return BITMAP_ERROR_INVALID_PATH;
+		//Write row by row:
+		for (uint32_t rowPx = 0; (rowPx < rows) && (success == BITMAP_ERROR_SUCCESS); rowPx++)
+		{
+			//Get the row (the view knows where it starts) and write it:
+			success = bitmapWriteRow(bitmap, bitmapViewRow(&source, rowPx), outputRow, bytesPerRow);
 		}
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "File has been opened successfully.");
+	//Free the row data, the band and the pixel row:
+	free(outputRow);
+	free(band);
+	free(bitmap->pixelRow);
 
-	//Set file pointer:
-	bitmap->file = file;
+	//Finished!
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "All pixels have been compressed.");
 
-	return BITMAP_ERROR_SUCCESS;
+	return success;
 }
 
-//User-accessible.
-bitmap_error_t bitmapReadPixels(const char* filePath, bitmap_pixel_t** pixels, uint32_t* widthPx, uint32_t* heightPx, bitmap_color_space_t colorSpace)
+//Internal DIB header writing function (BITMAP_DIB_HEADER_INFO).
+//
+//Errors:
+//
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the parameters. Or we don't support some feature.
+//- BITMAP_ERROR_IO                   A read error has occurred.
+//
+//The file will not be closed by this function.
+bitmap_error_t bitmapWriteDIBHeader_Info(bitmap_t* bitmap)
 {
-	//NULL the pointers:
-	*pixels = NULL;
-	*widthPx = 0;
-	*heightPx = 0;
-
-	//Init a bitmap struct:
-	bitmap_t bitmap;
-	memset(&bitmap, 0, sizeof(bitmap_t));
-
-	//Assign our color space:
-	bitmap.parameters.colorSpace = colorSpace;
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to write DIB header (BITMAP_DIB_HEADER_INFO) ...");
 
 	//Status var:
 	bitmap_error_t success;
 
-	//Open the bitmap file for reading:
-	if ((success = bitmapOpenFile(&bitmap, filePath)) != BITMAP_ERROR_SUCCESS)
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header length ...");
+
+	if ((success = bitmapWriteU32(bitmap, BITMAP_DIB_HEADER_INFO)) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	//Read the bitmap header:
-	if ((success = bitmapReadHeader(&bitmap)) != BITMAP_ERROR_SUCCESS)
+	//Write pixel width:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel width ...");
+
+	if ((success = bitmapWriteU32(bitmap, bitmap->parameters.widthPx)) != BITMAP_ERROR_SUCCESS)
 	{
-		//Close the file:
-		fclose(bitmap.file);
+		return success;
+	}
+
+	//Write pixel height:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel height ...");
+
+	int32_t heightPx = (int32_t)bitmap->parameters.heightPx;
+
+	if (!bitmap->parameters.bottomUp)
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Negating pixel height (because we want top-down) ...");
+		heightPx *= -1;
+	}
 
+	if ((success = bitmapWriteI32(bitmap, heightPx)) != BITMAP_ERROR_SUCCESS)
+	{
 		return success;
 	}
 
-	//Jump to the pixel offset:
-	fseek(bitmap.file, bitmap.pixelOffset, SEEK_SET);
-	int err = ferror(bitmap.file);
+	//Write BiPlanes:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing BiPlanes ...");
 
-	if (err)
+	if ((success = bitmapWriteU16(bitmap, 1)) != BITMAP_ERROR_SUCCESS)
 	{
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek pixel offset: IO error (%d).", err);
+		return success;
+	}
 
-		//Close the file:
-		fclose(bitmap.file);
+	//Switch over color depth:
+	switch (bitmap->parameters.colorDepth)
+	{
+	case BITMAP_COLOR_DEPTH_1:
 
-		return BITMAP_ERROR_IO;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 2 indexed colors ...");
+		break;
+
+	case BITMAP_COLOR_DEPTH_4:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 16 indexed colors ...");
+		break;
+
+	case BITMAP_COLOR_DEPTH_8:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 256 indexed colors ...");
+		break;
+
+	case BITMAP_COLOR_DEPTH_16:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 16 bit ...");
+		break;
+
+	case BITMAP_COLOR_DEPTH_24:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 24 bit ...");
+		break;
+
+	case BITMAP_COLOR_DEPTH_32:
+
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 32 bit ...");
+		break;
+
+	default:
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown color depth: %u bit", bitmap->parameters.colorDepth);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	//Switch over the compression.
-	//Only BITMAP_COMPRESSION_NONE for the moment.
-	switch (bitmap.parameters.compression)
+	if ((success = bitmapWriteU16(bitmap, bitmap->parameters.colorDepth)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	//Switch over compression:
+	switch (bitmap->parameters.compression)
 	{
 	case BITMAP_COMPRESSION_NONE:
 
-		success = bitmapReadPixelsCompression_None(&bitmap, pixels);
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_NONE ...");
+
+		if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
+
 		break;
 
 	case BITMAP_COMPRESSION_RLE:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_RLE ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_RLE ...");
+
+		switch (bitmap->parameters.colorDepth)
+		{
+		case BITMAP_COLOR_DEPTH_8:
+
+			if ((success = bitmapWriteU32(bitmap, 1)) != BITMAP_ERROR_SUCCESS)
+			{
+				return success;
+			}
+
+			break;
+
+		case BITMAP_COLOR_DEPTH_4:
+
+			if ((success = bitmapWriteU32(bitmap, 2)) != BITMAP_ERROR_SUCCESS)
+			{
+				return success;
+			}
+
+			break;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	case BITMAP_COMPRESSION_BITFIELD_RGB:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_BITFIELD_RGB ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_BITFIELD_RGB ...");
+
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		if ((success = bitmapWriteU32(bitmap, 3)) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	case BITMAP_COMPRESSION_BITFIELD_ARGB:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Decompressing BITMAP_COMPRESSION_BITFIELD_ARGB ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_BITFIELD_ARGB ...");
+
+		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		}
+
+		if ((success = bitmapWriteU32(bitmap, 6)) != BITMAP_ERROR_SUCCESS)
+		{
+			return success;
+		}
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	default:
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown compression scheme.");
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-
-		break;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown bitmap compression.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	//Close the file:
-	fclose(bitmap.file);
+	//Write the size of the pixel data (TODO: Fix for other compressions):
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel data size in bytes (currently 0, fixme) ...");
 
-	//If that has worked, we can set the dimensions now.
-	if (success == BITMAP_ERROR_SUCCESS)
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
 	{
-		*widthPx = bitmap.parameters.widthPx;
-		*heightPx = bitmap.parameters.heightPx;
+		return success;
 	}
 
-	return success;
-}
+	//Write the bitmap destination resolution:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing bitmap destination resolution ...");
 
-/**********************************************************************************************************************************************************************
-	Writing
-**********************************************************************************************************************************************************************/
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-//Internal writing function.
-//Always writes "count" bytes.
-//
-//Errors:
-//
-//- BITMAP_ERROR_IO  A write error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapWriteBytes(FILE* file, uint8_t* buffer, size_t count)
-{
-	if (fwrite(buffer, 1, count, file) != count)
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
 	{
-		int err = ferror(file);
+		return success;
+	}
 
-		if (err)
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to write bytes: IO error (%d).", err);
-			return BITMAP_ERROR_IO;
-		}
+	//Write the color table entries (TODO: Fix for other compressions):
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color table entries (currently 0, fixme) ...");
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to write bytes: Unknown IO error.");
-		return BITMAP_ERROR_IO;
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
 	}
 
-	return BITMAP_ERROR_SUCCESS;
-}
-
-//Some typed functions with the same behavior:
-bitmap_error_t bitmapWriteU8(FILE* file, uint8_t value)
-{
-	return bitmapWriteBytes(file, &value, sizeof(uint8_t));
-}
+	//Write the important color table entries (TODO: Fix for other compressions):
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing important color table entries (currently 0, fixme) ...");
 
-bitmap_error_t bitmapWriteI8(FILE* file, int8_t value)
-{
-	return bitmapWriteBytes(file, (uint8_t*)&value, sizeof(int8_t));
-}
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-bitmap_error_t bitmapWriteU16(FILE* file, uint16_t value)
-{
-	return bitmapWriteBytes(file, (uint8_t*)&value, sizeof(uint16_t));
-}
+	//Write the bitmasks:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing bitmasks (currently not at all, fixme) ...");
 
-bitmap_error_t bitmapWriteI16(FILE* file, int16_t value)
-{
-	return bitmapWriteBytes(file, (uint8_t*)&value, sizeof(int16_t));
-}
+	//Write the color table:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color table (currently not at all, fixme) ...");
 
-bitmap_error_t bitmapWriteU32(FILE* file, uint32_t value)
-{
-	return bitmapWriteBytes(file, (uint8_t*)&value, sizeof(uint32_t));
-}
+	//Okay, that worked :-)
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "DIB header (info) has successfully been written.");
 
-bitmap_error_t bitmapWriteI32(FILE* file, int32_t value)
-{
-	return bitmapWriteBytes(file, (uint8_t*)&value, sizeof(int32_t));
+	return BITMAP_ERROR_SUCCESS;
 }
 
-//Internal pixel row writing function (BITMAP_COLOR_DEPTH_24).
+
+
+//Internal header writing function.
 //
 //Errors:
-//- BITMAP_ERROR_IO                   An IO error has occurred.
+//
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the header. Or we don't support some feature.
+//- BITMAP_ERROR_IO                   A read error has occurred.
 //
 //The file will not be closed by this function.
-bitmap_error_t bitmapWriteRowColorDepth_24(bitmap_t* bitmap, const bitmap_pixel_t* rowData, size_t paddingBytesPerRow)
+bitmap_error_t bitmapWriteHeader(bitmap_t* bitmap)
 {
-	//Get the width:
-	uint32_t widthPx = bitmap->parameters.widthPx;
-
-	//Get the color space:
-	bitmap_color_space_t colorSpace = bitmap->parameters.colorSpace;
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to write header ...");
 
 	//Status var:
 	bitmap_error_t success;
 
-	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	//Everything is known up front, so there is no need to patch the header afterwards:
+	size_t bitsPerRow = bitmap->parameters.colorDepth * bitmap->parameters.widthPx;
+	uint64_t bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
+	uint64_t fileSize = BITMAP_FILE_HEADER_SIZE + bitmap->parameters.dibHeaderFormat + (bytesPerRow * bitmap->parameters.heightPx);
+
+	if (fileSize > UINT32_MAX)
 	{
-		bitmap_pixel_rgb_t currPixel = pixelToRGB(rowData[colPx], colorSpace);
-		bitmap_component_t pixelData[3] = { currPixel.b, currPixel.g, currPixel.r };
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "The bitmap would be larger than 4 GiB.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-		if ((success = bitmapWriteBytes(bitmap->file, (uint8_t*)pixelData, sizeof(pixelData))) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+	bitmap->pixelOffset = BITMAP_FILE_HEADER_SIZE + bitmap->parameters.dibHeaderFormat;
+	bitmap->fileSize = (uint32_t)fileSize;
+
+	//Write magic number:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing magic number ...");
+
+	if ((success = bitmapWriteU16(bitmap, BITMAP_MAGIC_NUMBER)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
 	}
 
-	for (size_t i = 0; i < paddingBytesPerRow; i++)
+	//Write the size in bytes:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing file size in bytes: %u ...", bitmap->fileSize);
+
+	if ((success = bitmapWriteU32(bitmap, bitmap->fileSize)) != BITMAP_ERROR_SUCCESS)
 	{
-		if ((success = bitmapWriteU8(bitmap->file, 0x00)) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+		return success;
 	}
 
-	return BITMAP_ERROR_SUCCESS;
-}
+	//Write the writer-specific blob:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing writer-specific blob ...");
 
-//Internal pixel row writing function (BITMAP_COLOR_DEPTH_32).
-//
-//Errors:
-//- BITMAP_ERROR_IO                   An IO error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapWriteRowColorDepth_32(bitmap_t* bitmap, const bitmap_pixel_t* rowData)
-{
-	//Get the width:
-	uint32_t widthPx = bitmap->parameters.widthPx;
+	if ((success = bitmapWriteU32(bitmap, 0)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-	//Get the color space:
-	bitmap_color_space_t colorSpace = bitmap->parameters.colorSpace;
+	//Write the pixel offset (no color table, the pixels follow the DIB header):
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel offset: 0x%04X ...", bitmap->pixelOffset);
 
-	//Status var:
-	bitmap_error_t success;
+	if ((success = bitmapWriteU32(bitmap, bitmap->pixelOffset)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	//Which DIB header format do we use?
+	switch (bitmap->parameters.dibHeaderFormat)
 	{
-		bitmap_pixel_rgb_t currPixel = pixelToRGB(rowData[colPx], colorSpace);
-		bitmap_component_t pixelData[4] = { currPixel.b, currPixel.g, currPixel.r, currPixel.c3 };
+		case BITMAP_DIB_HEADER_CORE_OS2_1X:
 
-		if ((success = bitmapWriteBytes(bitmap->file, (uint8_t*)pixelData, sizeof(pixelData))) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
-	}
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_CORE_OS2_1X");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
 
-	return BITMAP_ERROR_SUCCESS;
-}
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
 
-//Internal pixel writing function (BITMAP_COMPRESSION_NONE).
-//
-//Errors:
-//- BITMAP_ERROR_IO                   An IO error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapWritePixelsCompression_None(bitmap_t* bitmap, const bitmap_pixel_t* pixels)
-{
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_NONE ...");
+		case BITMAP_DIB_HEADER_OS2_2X:
 
-	//Get width and height:
-	uint32_t widthPx = bitmap->parameters.widthPx;
-	uint32_t heightPx = bitmap->parameters.heightPx;
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_OS2_2X");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
 
-	//How many bytes are in a row?
-	size_t bitsPerRow = bitmap->parameters.colorDepth * widthPx;
-	size_t bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
-	size_t paddingBytesPerRow = bytesPerRow - (bitsPerRow / 8);
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		case BITMAP_DIB_HEADER_OS2_2X_SHORT:
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bits / bytes / padding bytes per row: %zu / %zu / %zu", bitsPerRow, bytesPerRow, paddingBytesPerRow);
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_OS2_2X_SHORT");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
 
-	//Status var:
-	bitmap_error_t success;
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
 
-	//Write row by row:
-	for (uint32_t rowPx = 0; rowPx < heightPx; rowPx++)
-	{
-		//Get the row:
-		const bitmap_pixel_t* rowData = &pixels[(rowPx * widthPx)];
+		case BITMAP_DIB_HEADER_INFO:
 
-		//Write it, depending on the color depth:
-		switch (bitmap->parameters.colorDepth)
-		{
-		case BITMAP_COLOR_DEPTH_24:
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO");
 
-			bitmapWriteRowColorDepth_24(bitmap, rowData, paddingBytesPerRow);
-			success = BITMAP_ERROR_SUCCESS;
+			if ((success = bitmapWriteDIBHeader_Info(bitmap)) != BITMAP_ERROR_SUCCESS)
+			{
+				return success;
+			}
 
 			break;
 
-		case BITMAP_COLOR_DEPTH_32:
+		case BITMAP_DIB_HEADER_INFO_V2:
 
-			//Note: Never padded!
-			bitmapWriteRowColorDepth_32(bitmap, rowData);
-			success = BITMAP_ERROR_SUCCESS;
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V2");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
 
-			break;
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
 
-		default:
+		case BITMAP_DIB_HEADER_INFO_V3:
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Color depth is not (yet) supported. Sorry!");
-			success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V3");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
 
-		//Check success:
-		if (success != BITMAP_ERROR_SUCCESS)
-		{
-			break;
-		}
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		case BITMAP_DIB_HEADER_INFO_V4:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V4");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		case BITMAP_DIB_HEADER_INFO_V5:
+
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V5");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is unknown.");
+			return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	//Finished!
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "All pixels have been compressed.");
+	//That's it:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap header writing has succeeded!");
 
-	return success;
+	return BITMAP_ERROR_SUCCESS;
 }
 
-//Internal DIB header writing function (BITMAP_DIB_HEADER_INFO).
+//Internal file creation function.
+//If the function succeeds, the file pointer in the bitmap struct is valid.
 //
 //Errors:
 //
-//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the parameters. Or we don't support some feature.
-//- BITMAP_ERROR_IO                   A read error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapWriteDIBHeader_Info(bitmap_t* bitmap)
+//- BITMAP_ERROR_INVALID_PATH  The given path is not valid in any way (missing intermediates, bad permissions etc.).
+//- BITMAP_ERROR_MEMORY        Insufficient memory.
+//- BITMAP_ERROR_FILE_EXISTS   The file at the given path already exists (and overwriteExisting is false).
+bitmap_error_t bitmapCreateFile(bitmap_t* bitmap, const char* filePath, bitmap_bool_t overwriteExisting)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to write DIB header (BITMAP_DIB_HEADER_INFO) ...");
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Going to create file \"%s\" ...", filePath);
 
-	//Status var:
-	bitmap_error_t success;
+	//Check the access to the file path:
+	if (access(filePath, R_OK | W_OK) == 0)
+	{
+		//The file already exists. Is that allowed?
+		if (!overwriteExisting)
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "File at \"%s\" already exists.", filePath);
+			bitmapLog(BITMAP_LOGGING_VERBOSE, "Set \"overwriteExisting = true\" to ignore that case.");
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header length ...");
+			return BITMAP_ERROR_FILE_EXISTS;
+		}
 
-	if ((success = bitmapWriteU32(bitmap->file, BITMAP_DIB_HEADER_INFO)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Overwriting existing file because of BITMAP_FLAG_OVERWRITE_EXISTING ...");
 	}
+	else
+	{
+		switch (errno)
+		{
+		case ENOENT:
 
-	//Write pixel width:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel width ...");
+			//This should be the normal case because the file does not exist.
+			//It might also appear because of invalid path components. That will be revealed at fopen(...).
+			break;
 
-	if ((success = bitmapWriteU32(bitmap->file, bitmap->parameters.widthPx)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
+		case ENOMEM:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for accessing the file.");
+			return BITMAP_ERROR_MEMORY;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error accessing file at \"%s\": %s", filePath, strerror(errno));
+			return BITMAP_ERROR_INVALID_PATH;
+		}
 	}
 
-	//Write pixel height:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel height ...");
+	//Try to open the file, bypassing the page cache if requested:
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	bitmap_bool_t directIO = bitmap->parameters.writeOptions.directIO;
 
-	int32_t heightPx = (int32_t)bitmap->parameters.heightPx;
+	int fd = open(filePath, flags | (directIO ? O_DIRECT : 0), 0666);
 
-	if (!bitmap->parameters.bottomUp)
+	if ((fd < 0) && directIO && (errno == EINVAL))
 	{
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Negating pixel height (because we want top-down) ...");
-		heightPx *= -1;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Direct IO is not supported for \"%s\", falling back to buffered IO.", filePath);
+
+		directIO = BITMAP_BOOL_FALSE;
+		fd = open(filePath, flags, 0666);
 	}
 
-	if ((success = bitmapWriteI32(bitmap->file, heightPx)) != BITMAP_ERROR_SUCCESS)
+	if (fd < 0)
 	{
-		return success;
-	}
+		switch (errno)
+		{
+		case ENOENT:
 
-	//Write BiPlanes:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing BiPlanes ...");
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "File path to \"%s\" is invalid. Are the intermediate directories there?", filePath);
+			return BITMAP_ERROR_INVALID_PATH;
 
-	if ((success = bitmapWriteU16(bitmap->file, 1)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
+		case ENOMEM:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for creating file.");
+			return BITMAP_ERROR_MEMORY;
+
+		default:
+
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error creating file at \"%s\": %s", filePath, strerror(errno));
+			return BITMAP_ERROR_INVALID_PATH;
+		}
 	}
 
-	//Switch over color depth:
-	switch (bitmap->parameters.colorDepth)
-	{
-	case BITMAP_COLOR_DEPTH_1:
+	//Allocate the (aligned) staging buffer:
+	void* staging = NULL;
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 2 indexed colors ...");
-		break;
+	if (posix_memalign(&staging, BITMAP_STAGING_ALIGNMENT, BITMAP_STAGING_BYTES) != 0)
+	{
+		close(fd);
 
-	case BITMAP_COLOR_DEPTH_4:
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating staging buffer.");
+		return BITMAP_ERROR_MEMORY;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 16 indexed colors ...");
-		break;
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "File has been created successfully (direct IO: %s).", (directIO ? "true" : "false"));
 
-	case BITMAP_COLOR_DEPTH_8:
+	//Set file descriptor and staging buffer:
+	bitmap->fd = fd;
+	bitmap->directIO = directIO;
+	bitmap->staging = (uint8_t*)staging;
+	bitmap->stagingUsed = 0;
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 256 indexed colors ...");
-		break;
+	return BITMAP_ERROR_SUCCESS;
+}
 
-	case BITMAP_COLOR_DEPTH_16:
+//Internal file preallocation function.
+//Reserves the final size of the file (known after the header has been written) if requested.
+//This is only a hint, so failures are logged but ignored.
+void bitmapPreallocateFile(bitmap_t* bitmap)
+{
+	if (!bitmap->parameters.writeOptions.preallocate)
+	{
+		return;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 16 bit ...");
-		break;
+	int err = posix_fallocate(bitmap->fd, 0, bitmap->fileSize);
 
-	case BITMAP_COLOR_DEPTH_24:
+	if (err)
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Failed to preallocate %u bytes (ignored): %s", bitmap->fileSize, strerror(err));
+	}
+}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 24 bit ...");
-		break;
+//Internal file finishing function.
+//Writes out the rest of the staging buffer and closes the file (in any case).
+//
+//Errors:
+//- BITMAP_ERROR_IO                   An IO error has occurred.
+bitmap_error_t bitmapFinishFile(bitmap_t* bitmap)
+{
+	//Status var:
+	bitmap_error_t success;
 
-	case BITMAP_COLOR_DEPTH_32:
+	//O_DIRECT only takes whole blocks, the tail goes through the page cache:
+	size_t alignedBytes = bitmap->stagingUsed;
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color depth: 32 bit ...");
-		break;
+	if (bitmap->directIO)
+	{
+		alignedBytes -= alignedBytes % BITMAP_STAGING_ALIGNMENT;
+	}
 
-	default:
+	success = bitmapWriteFileDescriptor(bitmap->fd, bitmap->staging, alignedBytes);
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown color depth: %u bit", bitmap->parameters.colorDepth);
-		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	if ((success == BITMAP_ERROR_SUCCESS) && (alignedBytes < bitmap->stagingUsed))
+	{
+		fcntl(bitmap->fd, F_SETFL, fcntl(bitmap->fd, F_GETFL) & ~O_DIRECT);
+		success = bitmapWriteFileDescriptor(bitmap->fd, bitmap->staging + alignedBytes, bitmap->stagingUsed - alignedBytes);
 	}
 
-	if ((success = bitmapWriteU16(bitmap->file, bitmap->parameters.colorDepth)) != BITMAP_ERROR_SUCCESS)
+	//Drop the written pages from the page cache (they have to be clean for that):
+	if ((success == BITMAP_ERROR_SUCCESS) && bitmap->parameters.writeOptions.dropCache)
 	{
-		return success;
+		fdatasync(bitmap->fd);
+		posix_fadvise(bitmap->fd, 0, 0, POSIX_FADV_DONTNEED);
 	}
 
-	//Switch over compression:
-	switch (bitmap->parameters.compression)
+	//Close the file:
+	if (close(bitmap->fd) != 0)
 	{
-	case BITMAP_COMPRESSION_NONE:
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to close file: IO error (%s).", strerror(errno));
+		success = BITMAP_ERROR_IO;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_NONE ...");
+	free(bitmap->staging);
+	bitmap->staging = NULL;
 
-		if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+	return success;
+}
 
-		break;
+//Internal file writing function.
+//The rows come from the view, or (if there is a row callback) from bands that are filled by the callback.
+//
+//Errors: See bitmapWritePixels(...).
+bitmap_error_t bitmapWriteFile(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_view_t* view, bitmap_row_callback_t rowCallback, void* userData)
+{
+	//Init a bitmap struct:
+	bitmap_t bitmap;
+	memset(&bitmap, 0, sizeof(bitmap_t));
 
-	case BITMAP_COMPRESSION_RLE:
+	//Status var:
+	bitmap_error_t success;
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_RLE ...");
+	//Copy the parameters:
+	bitmap.parameters = *parameters;
 
-		switch (bitmap->parameters.colorDepth)
-		{
-		case BITMAP_COLOR_DEPTH_8:
+	//Create the bitmap file:
+	if ((success = bitmapCreateFile(&bitmap, filePath, overwriteExisting)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-			if ((success = bitmapWriteU32(bitmap->file, 1)) != BITMAP_ERROR_SUCCESS)
-			{
-				return success;
-			}
+	//Write the header:
+	if ((success = bitmapWriteHeader(&bitmap)) != BITMAP_ERROR_SUCCESS)
+	{
+		//Close the file:
+		bitmapFinishFile(&bitmap);
 
-			break;
+		return success;
+	}
 
-		case BITMAP_COLOR_DEPTH_4:
+	//Reserve the whole file:
+	bitmapPreallocateFile(&bitmap);
 
-			if ((success = bitmapWriteU32(bitmap->file, 2)) != BITMAP_ERROR_SUCCESS)
-			{
-				return success;
-			}
+	//Switch over the compression.
+	//Only BITMAP_COMPRESSION_NONE for the moment.
+	switch (bitmap.parameters.compression)
+	{
+	case BITMAP_COMPRESSION_NONE:
 
-			break;
+		success = bitmapWritePixelsCompression_None(&bitmap, view, rowCallback, userData);
+		break;
 
-		default:
+	case BITMAP_COMPRESSION_RLE:
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_RLE ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	case BITMAP_COMPRESSION_BITFIELD_RGB:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_BITFIELD_RGB ...");
-
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
-
-		if ((success = bitmapWriteU32(bitmap->file, 3)) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_BITFIELD_RGB ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	case BITMAP_COMPRESSION_BITFIELD_ARGB:
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing compression: BITMAP_COMPRESSION_BITFIELD_ARGB ...");
-
-		if ((bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_16) && (bitmap->parameters.colorDepth != BITMAP_COLOR_DEPTH_32))
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid bitmap compression in this context.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
-		}
-
-		if ((success = bitmapWriteU32(bitmap->file, 6)) != BITMAP_ERROR_SUCCESS)
-		{
-			return success;
-		}
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_BITFIELD_ARGB ...");
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
 
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
 		break;
 
 	default:
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown bitmap compression.");
-		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown compression scheme.");
+		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+
+		break;
 	}
 
-	//Write the size of the pixel data (TODO: Fix for other compressions):
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel data size in bytes (currently 0, fixme) ...");
+	//Flush and close the file:
+	bitmap_error_t finishSuccess = bitmapFinishFile(&bitmap);
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
-	}
+	return (success != BITMAP_ERROR_SUCCESS) ? success : finishSuccess;
+}
 
-	//Write the bitmap destination resolution:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing bitmap destination resolution ...");
+bitmap_error_t bitmapWritePixels(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_pixel_t* pixels)
+{
+	//A contiguous buffer is just the simplest view:
+	bitmap_view_t view = bitmapViewFromPixels((bitmap_pixel_t*)pixels, parameters->widthPx, parameters->heightPx);
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
-	}
+	return bitmapWriteView(filePath, overwriteExisting, parameters, &view);
+}
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
-	{
-		return success;
-	}
+//User-accessible.
+bitmap_error_t bitmapReadParameters(const char* filePath, bitmap_parameters_t* parameters)
+{
+	//Init a bitmap struct:
+	bitmap_t bitmap;
+	memset(&bitmap, 0, sizeof(bitmap_t));
 
-	//Write the color table entries (TODO: Fix for other compressions):
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color table entries (currently 0, fixme) ...");
+	//Status var:
+	bitmap_error_t success;
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
+	//Open the bitmap file for reading:
+	if ((success = bitmapOpenFile(&bitmap, filePath)) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	//Write the important color table entries (TODO: Fix for other compressions):
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing important color table entries (currently 0, fixme) ...");
+	//Read the bitmap header:
+	success = bitmapReadHeader(&bitmap);
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
+	//Close the file:
+	fclose(bitmap.file);
+
+	if (success == BITMAP_ERROR_SUCCESS)
 	{
-		return success;
+		*parameters = bitmap.parameters;
 	}
 
-	//Write the bitmasks:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing bitmasks (currently not at all, fixme) ...");
+	return success;
+}
 
-	//Write the color table:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing color table (currently not at all, fixme) ...");
+//User-accessible.
+bitmap_error_t bitmapWriteView(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_view_t* view)
+{
+	//The dimensions and the pixel format come from the view:
+	bitmap_parameters_t viewParameters = *parameters;
+	viewParameters.widthPx = view->widthPx;
+	viewParameters.heightPx = view->heightPx;
+	viewParameters.pixelFormat = view->pixelFormat;
 
-	//Okay, that worked :-)
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "DIB header (info) has successfully been written.");
+	return bitmapWriteFile(filePath, overwriteExisting, &viewParameters, view, NULL, NULL);
+}
 
-	return BITMAP_ERROR_SUCCESS;
+//User-accessible.
+bitmap_error_t bitmapWriteBands(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, bitmap_row_callback_t rowCallback, void* userData)
+{
+	//An unknown pixel format would give empty bands:
+	if (!bitmapPixelFormatSize(parameters->pixelFormat))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown pixel format.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	return bitmapWriteFile(filePath, overwriteExisting, parameters, NULL, rowCallback, userData);
 }
 
+/**********************************************************************************************************************************************************************
+	Transforming
+**********************************************************************************************************************************************************************/
 
+//How many bytes of pixels should a band have?
+//The band should still be in the L2 cache when it is processed and encoded after decoding it.
+//With OpenMP, a band has this many bytes per thread, so the callback can give every thread a part that fits into the cache of its core.
+#define BITMAP_TRANSFORM_BAND_BYTES (256 * 1024)
 
-//Internal header writing function.
+//Internal band transforming function (BITMAP_COMPRESSION_NONE on both sides).
 //
 //Errors:
+//- BITMAP_ERROR_INVALID_FILE_FORMAT  The color depth is not supported.
+//- BITMAP_ERROR_IO                   An IO error has occurred.
+//- BITMAP_ERROR_MEMORY               Insufficient memory.
+//- Any error returned by the row callback.
 //
-//- BITMAP_ERROR_INVALID_FILE_FORMAT  Something bad inside the header. Or we don't support some feature.
-//- BITMAP_ERROR_IO                   A read error has occurred.
-//
-//The file will not be closed by this function.
-bitmap_error_t bitmapWriteHeader(bitmap_t* bitmap)
+//The files will not be closed by this function.
+bitmap_error_t bitmapTransformCompression_None(bitmap_t* input, bitmap_t* output, bitmap_row_callback_t rowCallback, void* userData)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Starting to write header ...");
+	//Get width and height:
+	uint32_t widthPx = input->parameters.widthPx;
+	uint32_t heightPx = input->parameters.heightPx;
+
+	//How many bytes are in a row (on both sides)?
+	size_t inputBitsPerRow = input->parameters.colorDepth * widthPx;
+	size_t inputBytesPerRow = ((inputBitsPerRow + 31) / 32) * 4;
+
+	size_t outputBitsPerRow = output->parameters.colorDepth * widthPx;
+	size_t outputBytesPerRow = ((outputBitsPerRow + 31) / 32) * 4;
+
+	//How many bytes are in a row of the band?
+	bitmap_pixel_format_t pixelFormat = input->parameters.pixelFormat;
+	size_t pixelBytesPerRow = (size_t)widthPx * bitmapPixelFormatSize(pixelFormat);
 
 	//Status var:
 	bitmap_error_t success;
 
-	//Write magic number:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing magic number ...");
-
-	if ((success = bitmapWriteU16(bitmap->file, BITMAP_MAGIC_NUMBER)) != BITMAP_ERROR_SUCCESS)
+	//Select the row converters, depending on the color depths and the color space:
+	if ((success = bitmapSelectRowReader(input)) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	//Write the size in bytes (0 as dummy, fill this in later):
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing file size in bytes (dummy) ...");
-
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
+	if ((success = bitmapSelectRowWriter(output)) != BITMAP_ERROR_SUCCESS)
 	{
 		return success;
 	}
 
-	//Write the writer-specific blob:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing writer-specific blob ...");
+	//Prepare the conversions between the pixel format of the user and the files:
+	if ((success = bitmapAllocatePixelRow(input)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
+	if ((success = bitmapAllocatePixelRow(output)) != BITMAP_ERROR_SUCCESS)
 	{
+		free(input->pixelRow);
+
 		return success;
 	}
 
-	//Write the pixel offset (0 as dummy, fill this in later):
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing pixel offset (dummy) ...");
+	//How many rows fit into a band?
+	size_t bandBytes = BITMAP_TRANSFORM_BAND_BYTES;
+
+#ifdef _OPENMP
+	bandBytes *= omp_get_max_threads();
+#endif
+
+	uint32_t bandRows = bandBytes / pixelBytesPerRow;
+	bandRows = BITMAP_MAX(1, BITMAP_MIN(bandRows, heightPx));
+
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Transforming in bands of %u rows ...", bandRows);
+
+	//Allocate the band and the raw rows (the output row is zeroed, so the padding is zero):
+	uint8_t* band = (uint8_t*)malloc((size_t)bandRows * pixelBytesPerRow);
+	uint8_t* rowData = (uint8_t*)malloc(inputBytesPerRow);
+	uint8_t* outputRow = (uint8_t*)calloc(outputBytesPerRow, 1);
 
-	if ((success = bitmapWriteU32(bitmap->file, 0)) != BITMAP_ERROR_SUCCESS)
+	if (!band || !rowData || !outputRow)
 	{
-		return success;
+		free(band);
+		free(rowData);
+		free(outputRow);
+		free(input->pixelRow);
+		free(output->pixelRow);
+
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating band buffer.");
+		return BITMAP_ERROR_MEMORY;
 	}
 
-	//Which DIB header format do we use?
-	switch (bitmap->parameters.dibHeaderFormat)
+	//Band by band:
+	for (uint32_t firstRowPx = 0; (firstRowPx < heightPx) && (success == BITMAP_ERROR_SUCCESS); firstRowPx += bandRows)
 	{
-		case BITMAP_DIB_HEADER_CORE_OS2_1X:
+		uint32_t rows = BITMAP_MIN(bandRows, heightPx - firstRowPx);
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_CORE_OS2_1X");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+		//Decode:
+		for (uint32_t rowPx = 0; (rowPx < rows) && (success == BITMAP_ERROR_SUCCESS); rowPx++)
+		{
+			if ((success = bitmapReadBytes(input->file, rowData, inputBytesPerRow)) == BITMAP_ERROR_SUCCESS)
+			{
+				bitmapReadRow(input, rowData, &band[(size_t)rowPx * pixelBytesPerRow]);
+			}
+		}
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+		if (success != BITMAP_ERROR_SUCCESS)
+		{
+			break;
+		}
 
-		case BITMAP_DIB_HEADER_OS2_2X:
+		//Process while it is hot (a failed band stops the transform):
+		bitmap_view_t view = bitmapViewFromBuffer(band, widthPx, rows, pixelFormat);
+		success = rowCallback(&view, firstRowPx, userData);
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_OS2_2X");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+		//Encode:
+		for (uint32_t rowPx = 0; (rowPx < rows) && (success == BITMAP_ERROR_SUCCESS); rowPx++)
+		{
+			success = bitmapWriteRow(output, &band[(size_t)rowPx * pixelBytesPerRow], outputRow, outputBytesPerRow);
+		}
+	}
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	free(band);
+	free(rowData);
+	free(outputRow);
+	free(input->pixelRow);
+	free(output->pixelRow);
 
-		case BITMAP_DIB_HEADER_OS2_2X_SHORT:
+	return success;
+}
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_OS2_2X_SHORT");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+//User-accessible.
+bitmap_error_t bitmapTransform(const char* inPath, const char* outPath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, bitmap_row_callback_t rowCallback, void* userData)
+{
+	//Init the bitmap structs:
+	bitmap_t input;
+	memset(&input, 0, sizeof(bitmap_t));
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	bitmap_t output;
+	memset(&output, 0, sizeof(bitmap_t));
 
-		case BITMAP_DIB_HEADER_INFO:
+	//Assign our color space and pixel format:
+	input.parameters.colorSpace = parameters->colorSpace;
+	input.parameters.pixelFormat = parameters->pixelFormat;
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Identified DIB header: BITMAP_DIB_HEADER_INFO");
+	//Status var:
+	bitmap_error_t success;
 
-			if ((success = bitmapWriteDIBHeader_Info(bitmap)) != BITMAP_ERROR_SUCCESS)
-			{
-				return success;
-			}
+	//Open the input file and read its header:
+	if ((success = bitmapOpenFile(&input, inPath)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
 
-			break;
+	if ((success = bitmapReadHeader(&input)) != BITMAP_ERROR_SUCCESS)
+	{
+		//Close the file:
+		fclose(input.file);
 
-		case BITMAP_DIB_HEADER_INFO_V2:
+		return success;
+	}
+
+	//Only BITMAP_COMPRESSION_NONE for the moment.
+	if ((input.parameters.compression != BITMAP_COMPRESSION_NONE) || (parameters->compression != BITMAP_COMPRESSION_NONE))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported for transforms. Sorry!");
+
+		//Close the file:
+		fclose(input.file);
+
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Jump to the pixel offset:
+	fseek(input.file, input.pixelOffset, SEEK_SET);
+	int err = ferror(input.file);
+
+	if (err)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek pixel offset: IO error (%d).", err);
+
+		//Close the file:
+		fclose(input.file);
+
+		return BITMAP_ERROR_IO;
+	}
+
+	//The output has the dimensions and the orientation of the input:
+	parameters->widthPx = input.parameters.widthPx;
+	parameters->heightPx = input.parameters.heightPx;
+	parameters->bottomUp = input.parameters.bottomUp;
+
+	//Create the output file and write its header:
+	output.parameters = *parameters;
+
+	if ((success = bitmapCreateFile(&output, outPath, overwriteExisting)) != BITMAP_ERROR_SUCCESS)
+	{
+		//Close the file:
+		fclose(input.file);
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V2");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+		return success;
+	}
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	if ((success = bitmapWriteHeader(&output)) != BITMAP_ERROR_SUCCESS)
+	{
+		//Close the files:
+		fclose(input.file);
+		bitmapFinishFile(&output);
 
-		case BITMAP_DIB_HEADER_INFO_V3:
+		return success;
+	}
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V3");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+	//Reserve the whole file:
+	bitmapPreallocateFile(&output);
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	//Decode, process and encode band by band:
+	success = bitmapTransformCompression_None(&input, &output, rowCallback, userData);
 
-		case BITMAP_DIB_HEADER_INFO_V4:
+	//Close the input file:
+	fclose(input.file);
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V4");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+	//Flush and close the output file:
+	bitmap_error_t finishSuccess = bitmapFinishFile(&output);
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	return (success != BITMAP_ERROR_SUCCESS) ? success : finishSuccess;
+}
 
-		case BITMAP_DIB_HEADER_INFO_V5:
+/**********************************************************************************************************************************************************************
+	Reading band by band
+**********************************************************************************************************************************************************************/
 
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Writing DIB header size: BITMAP_DIB_HEADER_INFO_V5");
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is not (yet) supported. Sorry!");
+struct bitmap_band_reader_s {
+	//The bitmap that is read (its file is always at the start of the next row):
+	bitmap_t bitmap;
 
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	//A raw row of the file:
+	uint8_t* rowData;
+	size_t bytesPerRow;
 
-		default:
+	//The next row of the file:
+	uint32_t nextRowPx;
+};
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "DIB header format is unknown.");
-			return BITMAP_ERROR_INVALID_FILE_FORMAT;
+//User-accessible.
+void bitmapCloseBands(bitmap_band_reader_t* reader)
+{
+	if (!reader)
+	{
+		return;
 	}
 
-	//That's it:
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Bitmap header writing has succeeded!");
+	//Close the file:
+	if (reader->bitmap.file)
+	{
+		fclose(reader->bitmap.file);
+	}
 
-	return BITMAP_ERROR_SUCCESS;
+	free(reader->rowData);
+	free(reader->bitmap.pixelRow);
+	free(reader);
 }
 
-//Internal file creation function.
-//If the function succeeds, the file pointer in the bitmap struct is valid.
-//
-//Errors:
-//
-//- BITMAP_ERROR_INVALID_PATH  The given path is not valid in any way (missing intermediates, bad permissions etc.).
-//- BITMAP_ERROR_MEMORY        Insufficient memory.
-//- BITMAP_ERROR_FILE_EXISTS   The file at the given path already exists (and overwriteExisting is false).
-bitmap_error_t bitmapCreateFile(bitmap_t* bitmap, const char* filePath, bitmap_bool_t overwriteExisting)
+//User-accessible.
+bitmap_error_t bitmapOpenBands(const char* filePath, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat, bitmap_parameters_t* parameters, bitmap_band_reader_t** reader)
 {
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "Going to create file \"%s\" ...", filePath);
-
-	//Check the access to the file path:
-	if (access(filePath, R_OK | W_OK) == 0)
-	{
-		//The file already exists. Is that allowed?
-		if (!overwriteExisting)
-		{
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "File at \"%s\" already exists.", filePath);
-			bitmapLog(BITMAP_LOGGING_VERBOSE, "Set \"overwriteExisting = true\" to ignore that case.");
+	*reader = NULL;
 
-			return BITMAP_ERROR_FILE_EXISTS;
-		}
+	//Init the reader (the bitmap struct is zeroed with it):
+	bitmap_band_reader_t* bands = (bitmap_band_reader_t*)calloc(1, sizeof(bitmap_band_reader_t));
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Overwriting existing file because of BITMAP_FLAG_OVERWRITE_EXISTING ...");
-	}
-	else
+	if (!bands)
 	{
-		switch (errno)
-		{
-		case ENOENT:
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating band reader.");
+		return BITMAP_ERROR_MEMORY;
+	}
 
-			//This should be the normal case because the file does not exist.
-			//It might also appear because of invalid path components. That will be revealed at fopen(...).
-			break;
+	//Assign our color space and pixel format:
+	bands->bitmap.parameters.colorSpace = colorSpace;
+	bands->bitmap.parameters.pixelFormat = pixelFormat;
 
-		case ENOMEM:
+	//Status var:
+	bitmap_error_t success;
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for accessing the file.");
-			return BITMAP_ERROR_MEMORY;
+	//Open the input file and read its header:
+	if (((success = bitmapOpenFile(&bands->bitmap, filePath)) != BITMAP_ERROR_SUCCESS) || ((success = bitmapReadHeader(&bands->bitmap)) != BITMAP_ERROR_SUCCESS))
+	{
+		bitmapCloseBands(bands);
+		return success;
+	}
 
-		default:
+	//Only BITMAP_COMPRESSION_NONE for the moment.
+	if (bands->bitmap.parameters.compression != BITMAP_COMPRESSION_NONE)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported for reading bands. Sorry!");
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error accessing file at \"%s\": %s", filePath, strerror(errno));
-			return BITMAP_ERROR_INVALID_PATH;
-		}
+		bitmapCloseBands(bands);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
 	}
 
-	//Try to open the file:
-	FILE* file = fopen(filePath, "wb+");
-
-	if (!file)
+	//Select the row reader and prepare the conversion into the pixel format of the user:
+	if (((success = bitmapSelectRowReader(&bands->bitmap)) != BITMAP_ERROR_SUCCESS) || ((success = bitmapAllocatePixelRow(&bands->bitmap)) != BITMAP_ERROR_SUCCESS))
 	{
-		switch (errno)
-		{
-		case ENOENT:
+		bitmapCloseBands(bands);
+		return success;
+	}
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "File path to \"%s\" is invalid. Are the intermediate directories there?", filePath);
-			return BITMAP_ERROR_INVALID_PATH;
+	//Allocate memory for a raw row:
+	size_t bitsPerRow = bands->bitmap.parameters.colorDepth * bands->bitmap.parameters.widthPx;
+	bands->bytesPerRow = ((bitsPerRow + 31) / 32) * 4;
+	bands->rowData = (uint8_t*)malloc(bands->bytesPerRow);
 
-		case ENOMEM:
+	if (!bands->rowData)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating row buffer.");
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for creating file.");
-			return BITMAP_ERROR_MEMORY;
+		bitmapCloseBands(bands);
+		return BITMAP_ERROR_MEMORY;
+	}
 
-		default:
+	//Jump to the pixel offset:
+	fseek(bands->bitmap.file, bands->bitmap.pixelOffset, SEEK_SET);
+	int err = ferror(bands->bitmap.file);
 
-			bitmapLog(BITMAP_LOGGING_DEFAULT, "Error creating file at \"%s\": %s", filePath, strerror(errno));
-			return BITMAP_ERROR_INVALID_PATH;
-		}
+	if (err)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek pixel offset: IO error (%d).", err);
+
+		bitmapCloseBands(bands);
+		return BITMAP_ERROR_IO;
 	}
 
-	bitmapLog(BITMAP_LOGGING_VERBOSE, "File has been created successfully.");
+	//The file is read front to back, so the kernel may read further ahead:
+	posix_fadvise(fileno(bands->bitmap.file), 0, 0, POSIX_FADV_SEQUENTIAL);
 
-	//Set file pointer:
-	bitmap->file = file;
+	*parameters = bands->bitmap.parameters;
+	*reader = bands;
 
 	return BITMAP_ERROR_SUCCESS;
 }
 
-bitmap_error_t bitmapWritePixels(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_pixel_t* pixels)
+//User-accessible.
+bitmap_error_t bitmapReadBand(bitmap_band_reader_t* reader, const bitmap_view_t* band)
 {
-	//Init a bitmap struct:
-	bitmap_t bitmap;
-	memset(&bitmap, 0, sizeof(bitmap_t));
+	bitmap_t* bitmap = &reader->bitmap;
 
-	//Status var:
-	bitmap_error_t success;
+	if ((band->pixelFormat != bitmap->parameters.pixelFormat) || (band->widthPx != bitmap->parameters.widthPx))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "The band does not match the bitmap.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-	//Create the bitmap file:
-	if ((success = bitmapCreateFile(&bitmap, filePath, overwriteExisting)) != BITMAP_ERROR_SUCCESS)
+	if (band->heightPx > (bitmap->parameters.heightPx - reader->nextRowPx))
 	{
-		return success;
+		return BITMAP_ERROR_END_OF_STREAM;
 	}
 
-	//Copy the parameters:
-	bitmap.parameters = *parameters;
+	//Status var:
+	bitmap_error_t success = BITMAP_ERROR_SUCCESS;
 
-	//Write the header:
-	if ((success = bitmapWriteHeader(&bitmap)) != BITMAP_ERROR_SUCCESS)
+	//Decode row by row:
+	for (uint32_t rowPx = 0; (rowPx < band->heightPx) && (success == BITMAP_ERROR_SUCCESS); rowPx++)
 	{
-		//Close the file:
-		fclose(bitmap.file);
+		if ((success = bitmapReadBytes(bitmap->file, reader->rowData, reader->bytesPerRow)) == BITMAP_ERROR_SUCCESS)
+		{
+			bitmapReadRow(bitmap, reader->rowData, bitmapViewRow(band, rowPx));
+		}
+	}
 
-		return success;
+	if (success == BITMAP_ERROR_SUCCESS)
+	{
+		reader->nextRowPx += band->heightPx;
 	}
 
-	//Remember the pixel offset:
-	bitmap.pixelOffset = (uint32_t)ftell(bitmap.file);
+	return success;
+}
+
+/**********************************************************************************************************************************************************************
+	Frames
+**********************************************************************************************************************************************************************/
 
-	//Switch over the compression.
-	//Only BITMAP_COMPRESSION_NONE for the moment.
-	switch (bitmap.parameters.compression)
+//The magic number of a frame ("BMFR"):
+#define BITMAP_FRAME_MAGIC_NUMBER 0x52464D42
+
+//The header of a frame.
+typedef struct {
+	uint32_t magicNumber;
+	uint32_t widthPx;
+	uint32_t heightPx;
+	uint32_t pixelFormat;
+	uint32_t colorSpace;
+	uint32_t strideBytes;
+} bitmap_frame_header_t;
+
+//Internal function that converts a row of pixels between pixel formats and color spaces.
+//The pixel row is needed as intermediate storage (widthPx pixels).
+void bitmapConvertRow(const uint8_t* rowData, bitmap_pixel_format_t inputFormat, bitmap_color_space_t inputColorSpace, uint8_t* outputRow, bitmap_pixel_format_t outputFormat, bitmap_color_space_t outputColorSpace, uint32_t widthPx, bitmap_pixel_t* pixelRow)
+{
+	//Unpack:
+	if (inputFormat == BITMAP_PIXEL_FORMAT_24)
 	{
-	case BITMAP_COMPRESSION_NONE:
+		bitmapUnpackPixels((const bitmap_pixel24_t*)rowData, pixelRow, widthPx);
+	}
+	else
+	{
+		memcpy(pixelRow, rowData, (size_t)widthPx * sizeof(bitmap_pixel_t));
+	}
 
-		success = bitmapWritePixelsCompression_None(&bitmap, pixels);
-		break;
+	//Change the color space:
+	if (inputColorSpace != outputColorSpace)
+	{
+		for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+		{
+			pixelRow[colPx] = rgbToPixel(pixelToRGB(pixelRow[colPx], inputColorSpace), outputColorSpace);
+		}
+	}
 
-	case BITMAP_COMPRESSION_RLE:
+	//Pack:
+	if (outputFormat == BITMAP_PIXEL_FORMAT_24)
+	{
+		bitmapPackPixels(pixelRow, (bitmap_pixel24_t*)outputRow, widthPx);
+	}
+	else
+	{
+		memcpy(outputRow, pixelRow, (size_t)widthPx * sizeof(bitmap_pixel_t));
+	}
+}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_RLE ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+//User-accessible.
+bitmap_error_t bitmapReadFrame(FILE* stream, bitmap_view_t* view, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat)
+{
+	//NULL the view:
+	*view = bitmapViewFromBuffer(NULL, 0, 0, pixelFormat);
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-		break;
+	//Read the header. If nothing is left, this is the end of the stream:
+	bitmap_frame_header_t header;
+	size_t headerBytes = fread(&header, 1, sizeof(header), stream);
 
-	case BITMAP_COMPRESSION_BITFIELD_RGB:
+	if ((headerBytes == 0) && feof(stream))
+	{
+		bitmapLog(BITMAP_LOGGING_VERBOSE, "No more frames in the stream.");
+		return BITMAP_ERROR_END_OF_STREAM;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_BITFIELD_RGB ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+	if (headerBytes != sizeof(header))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to read frame header: Unexpected end of stream or IO error.");
+		return BITMAP_ERROR_IO;
+	}
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-		break;
+	//Check the header:
+	uint32_t inputPixelSize = bitmapPixelFormatSize(header.pixelFormat);
+	uint32_t outputPixelSize = bitmapPixelFormatSize(pixelFormat);
 
-	case BITMAP_COMPRESSION_BITFIELD_ARGB:
+	if (header.magicNumber != BITMAP_FRAME_MAGIC_NUMBER)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Invalid frame magic number: %x", header.magicNumber);
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-		bitmapLog(BITMAP_LOGGING_VERBOSE, "Compressing BITMAP_COMPRESSION_BITFIELD_ARGB ...");
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Compression scheme is not (yet) supported. Sorry!");
+	if (!inputPixelSize || !outputPixelSize || ((header.colorSpace != BITMAP_COLOR_SPACE_RGB) && (header.colorSpace != BITMAP_COLOR_SPACE_HSV)))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Pixel format or color space of the frame is not supported.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
-		break;
+	if (header.strideBytes < ((uint64_t)header.widthPx * inputPixelSize))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Frame stride is too small for the width.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-	default:
+	bitmapLog(BITMAP_LOGGING_VERBOSE, "Frame: %u x %u, pixel format %u, color space %u, stride %u", header.widthPx, header.heightPx, header.pixelFormat, header.colorSpace, header.strideBytes);
 
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Unknown compression scheme.");
-		success = BITMAP_ERROR_INVALID_FILE_FORMAT;
+	//Allocate space for the pixels:
+	size_t outputBytesPerRow = (size_t)header.widthPx * outputPixelSize;
+	uint8_t* outputData = (uint8_t*)malloc(outputBytesPerRow * header.heightPx);
 
-		break;
+	if (!outputData)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating pixel buffer.");
+		return BITMAP_ERROR_MEMORY;
 	}
 
-	//Get the file length:
-	uint32_t fileSize = (uint32_t)ftell(bitmap.file);
-
-	//Seek the offset for it:
-	fseek(bitmap.file, 2, SEEK_SET);
-	int err = ferror(bitmap.file);
+	//Status var:
+	bitmap_error_t success = BITMAP_ERROR_SUCCESS;
 
-	if (err)
+	if ((header.pixelFormat == (uint32_t)pixelFormat) && (header.colorSpace == (uint32_t)colorSpace) && (header.strideBytes == outputBytesPerRow))
+	{
+		//Nothing to convert, read all rows at once:
+		success = bitmapReadBytes(stream, outputData, outputBytesPerRow * header.heightPx);
+	}
+	else
 	{
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek file size offset: IO error (%d).", err);
+		//Convert row by row:
+		uint8_t* rowData = (uint8_t*)malloc(header.strideBytes);
+		bitmap_pixel_t* pixelRow = (bitmap_pixel_t*)malloc((size_t)header.widthPx * sizeof(bitmap_pixel_t));
 
-		//Close the file:
-		fclose(bitmap.file);
+		if (!rowData || !pixelRow)
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Insufficient memory for allocating row buffer.");
+			success = BITMAP_ERROR_MEMORY;
+		}
 
-		return BITMAP_ERROR_IO;
+		for (uint32_t rowPx = 0; (rowPx < header.heightPx) && (success == BITMAP_ERROR_SUCCESS); rowPx++)
+		{
+			if ((success = bitmapReadBytes(stream, rowData, header.strideBytes)) == BITMAP_ERROR_SUCCESS)
+			{
+				bitmapConvertRow(rowData, header.pixelFormat, header.colorSpace, &outputData[(size_t)rowPx * outputBytesPerRow], pixelFormat, colorSpace, header.widthPx, pixelRow);
+			}
+		}
+
+		free(rowData);
+		free(pixelRow);
 	}
 
-	//Write the file size:
-	if ((success = bitmapWriteU32(bitmap.file, fileSize)) != BITMAP_ERROR_SUCCESS)
+	if (success != BITMAP_ERROR_SUCCESS)
 	{
-		//Close the file:
-		fclose(bitmap.file);
-
-		return BITMAP_ERROR_IO;
+		free(outputData);
+		return success;
 	}
 
-	//Seek the offset for the pixel offset:
-	fseek(bitmap.file, 10, SEEK_SET);
-	err = ferror(bitmap.file);
+	*view = bitmapViewFromBuffer(outputData, header.widthPx, header.heightPx, pixelFormat);
 
-	if (err)
+	return BITMAP_ERROR_SUCCESS;
+}
+
+//User-accessible.
+bitmap_error_t bitmapWriteFrame(FILE* stream, const bitmap_view_t* view, bitmap_color_space_t colorSpace)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(view->pixelFormat);
+
+	if (!pixelSize)
 	{
-		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to seek pixel offset offset: IO error (%d).", err);
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Pixel format is not supported.");
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
 
-		//Close the file:
-		fclose(bitmap.file);
+	//The rows are always tightly packed:
+	bitmap_frame_header_t header;
+
+	header.magicNumber = BITMAP_FRAME_MAGIC_NUMBER;
+	header.widthPx = view->widthPx;
+	header.heightPx = view->heightPx;
+	header.pixelFormat = view->pixelFormat;
+	header.colorSpace = colorSpace;
+	header.strideBytes = view->widthPx * pixelSize;
 
+	if (fwrite(&header, 1, sizeof(header), stream) != sizeof(header))
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to write frame header: IO error (%d).", ferror(stream));
 		return BITMAP_ERROR_IO;
 	}
 
-	//Write the pixel offset:
-	if ((success = bitmapWriteU32(bitmap.file, bitmap.pixelOffset)) != BITMAP_ERROR_SUCCESS)
+	//Row by row, the view might not be contiguous:
+	for (uint32_t rowPx = 0; rowPx < view->heightPx; rowPx++)
 	{
-		//Close the file:
-		fclose(bitmap.file);
+		if (fwrite(bitmapViewRow(view, rowPx), 1, header.strideBytes, stream) != header.strideBytes)
+		{
+			bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to write frame row: IO error (%d).", ferror(stream));
+			return BITMAP_ERROR_IO;
+		}
+	}
 
+	//The next tool in the pipe is waiting:
+	if (fflush(stream) != 0)
+	{
+		bitmapLog(BITMAP_LOGGING_DEFAULT, "Failed to flush frame: IO error (%d).", ferror(stream));
 		return BITMAP_ERROR_IO;
 	}
 
-	//Flush:
-	fflush(bitmap.file);
-
-	//Close the file:
-	fclose(bitmap.file);
-
 	return BITMAP_ERROR_SUCCESS;
 }
@@ -6,15 +6,42 @@
 
 #include "dctquant.h"
 #include "bitmap.h"
+#include "resample.h"
+#include "rotate.h"
+#include "convolve.h"
 
 // Output path can be NULL to suppress the dumping of the grayscale bitmap.
-static bitmap_pixel_hsv_t* create_grayscale_bitmap(const char* input_path, const char* output_path, uint32_t* blocks_x, uint32_t* blocks_y)
+static bitmap_pixel_hsv_t* create_grayscale_bitmap(const char* input_path, const char* output_path, bitmap_orientation_t orientation, double blur_sigma, uint32_t* blocks_x, uint32_t* blocks_y)
 {
 	// Read the input bitmap:
 	bitmap_pixel_hsv_t* pixels;
 	uint32_t width_px, height_px;
 
-	bitmap_error_t error = bitmapReadPixels(input_path, (bitmap_pixel_t**)&pixels, &width_px, &height_px, BITMAP_COLOR_SPACE_HSV);
+	// Raw frames run from the top row down, bitmap files keep their own row order:
+	bitmap_bool_t bottom_up = BITMAP_BOOL_FALSE;
+	bitmap_error_t error;
+
+	// A path of "-" reads a raw frame from stdin:
+	if (strcmp(input_path, "-") == 0)
+	{
+		bitmap_view_t view;
+		error = bitmapReadFrame(stdin, &view, BITMAP_COLOR_SPACE_HSV, BITMAP_PIXEL_FORMAT_32);
+
+		pixels = (bitmap_pixel_hsv_t*)view.data;
+		width_px = view.widthPx;
+		height_px = view.heightPx;
+	}
+	else
+	{
+		bitmap_parameters_t parameters;
+		error = bitmapReadParameters(input_path, &parameters);
+
+		if (error == BITMAP_ERROR_SUCCESS)
+		{
+			bottom_up = parameters.bottomUp;
+			error = bitmapReadPixels(input_path, (bitmap_pixel_t**)&pixels, &width_px, &height_px, BITMAP_COLOR_SPACE_HSV);
+		}
+	}
 
 	if (error != BITMAP_ERROR_SUCCESS)
 	{
@@ -22,13 +49,93 @@ static bitmap_pixel_hsv_t* create_grayscale_bitmap(const char* input_path, const
 		return NULL;
 	}
 
-	// Make sure the bitmap has a multiple of 8 pixels in both dimensions:
+	// Turn the bitmap if requested (e.g. portrait scans). The blocks are compressed bottom row first, like the bitmaps written by the decompression.
+	// Bottom-up bitmaps are stored bottom row first, so the rows have to turn the other way round for the picture to turn clockwise:
+	if ((orientation != -1) || !bottom_up)
+	{
+		bitmap_view_t input = bitmapViewFromPixels((bitmap_pixel_t*)pixels, width_px, height_px);
+
+		// Raw frames and top-down bitmaps are turned through a flipped view (which is free), so their rows come out bottom row first too:
+		if (orientation == -1)
+		{
+			orientation = BITMAP_ORIENTATION_FLIP_VERTICAL;
+		}
+		else
+		{
+			if (!bottom_up)
+				input = bitmapViewFlipVertical(input);
+
+			orientation = bitmapViewOrientation(orientation, BITMAP_BOOL_TRUE);
+		}
+
+		uint32_t oriented_width_px = bitmapOrientationSwapsAxes(orientation) ? height_px : width_px;
+		uint32_t oriented_height_px = bitmapOrientationSwapsAxes(orientation) ? width_px : height_px;
+
+		bitmap_pixel_hsv_t* oriented = (bitmap_pixel_hsv_t*)malloc((size_t)width_px * height_px * sizeof(bitmap_pixel_hsv_t));
+		bitmap_view_t output = bitmapViewFromPixels((bitmap_pixel_t*)oriented, oriented_width_px, oriented_height_px);
+
+		if (!oriented || (bitmapOrientView(&input, &output, orientation) != BITMAP_ERROR_SUCCESS))
+		{
+			printf("Failed to turn the bitmap.\n");
+			free(oriented);
+			free(pixels);
+
+			return NULL;
+		}
+
+		free(pixels);
+		pixels = oriented;
+		width_px = oriented_width_px;
+		height_px = oriented_height_px;
+	}
+
+	// Resample the bitmap to the nearest multiple of 8 pixels in both dimensions (at least 8), only the value matters for the DCT:
 	if ((width_px % 8) || (height_px % 8))
 	{
-		printf("Width and height must be a multiple of 8 pixels.\n");
+		uint32_t resampled_width_px = (width_px < 12) ? 8 : (((width_px + 4) / 8) * 8);
+		uint32_t resampled_height_px = (height_px < 12) ? 8 : (((height_px + 4) / 8) * 8);
+
+		bitmap_pixel_hsv_t* resampled = (bitmap_pixel_hsv_t*)malloc((size_t)resampled_width_px * resampled_height_px * sizeof(bitmap_pixel_hsv_t));
+
+		bitmap_view_t input = bitmapViewFromPixels((bitmap_pixel_t*)pixels, width_px, height_px);
+		bitmap_view_t output = bitmapViewFromPixels((bitmap_pixel_t*)resampled, resampled_width_px, resampled_height_px);
+
+		if (!resampled || (bitmapResampleView(&input, &output, BITMAP_FILTER_BICUBIC) != BITMAP_ERROR_SUCCESS))
+		{
+			printf("Failed to resample the bitmap to a multiple of 8 pixels.\n");
+			free(resampled);
+			free(pixels);
+
+			return NULL;
+		}
+
+		fprintf(stderr, "Resampled %ux%u to %ux%u pixels (multiple of 8).\n", width_px, height_px, resampled_width_px, resampled_height_px);
+
 		free(pixels);
+		pixels = resampled;
+		width_px = resampled_width_px;
+		height_px = resampled_height_px;
+	}
 
-		return NULL;
+	// Blur the bitmap if requested, this cuts ringing (and size) of the blocks:
+	if (blur_sigma > 0.0)
+	{
+		bitmap_pixel_hsv_t* blurred = (bitmap_pixel_hsv_t*)malloc((size_t)width_px * height_px * sizeof(bitmap_pixel_hsv_t));
+
+		bitmap_view_t input = bitmapViewFromPixels((bitmap_pixel_t*)pixels, width_px, height_px);
+		bitmap_view_t output = bitmapViewFromPixels((bitmap_pixel_t*)blurred, width_px, height_px);
+
+		if (!blurred || (bitmapGaussianBlurView(&input, &output, blur_sigma) != BITMAP_ERROR_SUCCESS))
+		{
+			printf("Failed to blur the bitmap.\n");
+			free(blurred);
+			free(pixels);
+
+			return NULL;
+		}
+
+		free(pixels);
+		pixels = blurred;
 	}
 
 	// Assign the block size:
@@ -55,7 +162,16 @@ static bitmap_pixel_hsv_t* create_grayscale_bitmap(const char* input_path, const
 			.colorSpace = BITMAP_COLOR_SPACE_HSV,
 		};
 
-		error = bitmapWritePixels(output_path, BITMAP_BOOL_TRUE, &params, (bitmap_pixel_t*)pixels);
+		// A path of "-" writes a raw frame to stdout (frames run from the top row down):
+		if (strcmp(output_path, "-") == 0)
+		{
+			bitmap_view_t view = bitmapViewFlipVertical(bitmapViewFromPixels((bitmap_pixel_t*)pixels, width_px, height_px));
+			error = bitmapWriteFrame(stdout, &view, BITMAP_COLOR_SPACE_HSV);
+		}
+		else
+		{
+			error = bitmapWritePixels(output_path, BITMAP_BOOL_TRUE, &params, (bitmap_pixel_t*)pixels);
+		}
 
 		if (error != BITMAP_ERROR_SUCCESS)
 		{
@@ -69,21 +185,19 @@ static bitmap_pixel_hsv_t* create_grayscale_bitmap(const char* input_path, const
 	return pixels;
 }
 
-// Copy the block at (`index_x`, `index_y`) from the given pixel buffer into `block`.
-// The dimensions of the image (in blocks) is given by `blocks_x` * `blocks_y`.
-static void read_block(const bitmap_pixel_hsv_t* pixels, uint32_t index_x, uint32_t index_y, uint32_t blocks_x, uint32_t blocks_y, float* block)
+// Copy the block at (`index_x`, `index_y`) from the given view into `block`.
+// The view can be any crop of a bitmap, as long as it covers whole blocks.
+static void read_block(const bitmap_view_t* view, uint32_t index_x, uint32_t index_y, float* block)
 {
-	uint32_t bytes_per_row = blocks_x * 8;
-	uint32_t base_offset = index_y * 8 * bytes_per_row;
 	uint32_t col_offset = index_x * 8;
 
 	for (uint32_t curr_y = 0; curr_y < 8; curr_y++)
 	{
-		uint32_t row_offset = curr_y * bytes_per_row;
+		const bitmap_pixel_hsv_t* row = (const bitmap_pixel_hsv_t*)bitmapViewRow(view, (index_y * 8) + curr_y);
 
 		for (uint32_t curr_x = 0; curr_x < 8; curr_x++)
 		{
-			block[(8 * curr_y) + curr_x] = pixels[base_offset + row_offset + col_offset + curr_x].v - 128.0f;
+			block[(8 * curr_y) + curr_x] = row[col_offset + curr_x].v - 128.0f;
 		}
 	}
 }
@@ -121,7 +235,7 @@ static void zig_zag(int8_t* input_block, int8_t* output_block)
 		output_block[zig_zag_index_matrix[i]] = input_block[i];
 }
 
-int compress(const char* file_path, const uint32_t* quant_matrix, const char* grayscale_path, const char* output_path)
+int compress(const char* file_path, const uint32_t* quant_matrix, const char* grayscale_path, const char* output_path, bitmap_orientation_t orientation, double blur_sigma)
 {
 	float cosine_values[8][8];
 	for (size_t m = 0; m < 8; m++) for (size_t p = 0; p < 8; p++)
@@ -129,11 +243,13 @@ int compress(const char* file_path, const uint32_t* quant_matrix, const char* gr
 
 	// Load the bitmap in grayscale:
 	uint32_t blocks_x, blocks_y;
-	bitmap_pixel_hsv_t* pixels = create_grayscale_bitmap(file_path, grayscale_path, &blocks_x, &blocks_y);
+	bitmap_pixel_hsv_t* pixels = create_grayscale_bitmap(file_path, grayscale_path, orientation, blur_sigma, &blocks_x, &blocks_y);
 
 	if (!pixels)
 		return -1;
 
+	bitmap_view_t view = bitmapViewFromPixels((bitmap_pixel_t*)pixels, blocks_x * 8, blocks_y * 8);
+
 	// Open the output file (.dct):
 	FILE* file = fopen(output_path, "wb");
 
@@ -178,7 +294,7 @@ int compress(const char* file_path, const uint32_t* quant_matrix, const char* gr
 			int8_t zig_zagged_block[64];
 
 			// Read the next block:
-			read_block(pixels, index_x, index_y, blocks_x, blocks_y, input_block);
+			read_block(&view, index_x, index_y, input_block);
 
 			// Execute the actual DCT:
 			perform_dct(input_block, dct_block, cosine_values);
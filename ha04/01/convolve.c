@@ -0,0 +1,616 @@
+#include "convolve.h"
+
+//Min / max:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BITMAP_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+//The minimum number of rows per band.
+//Bands also grow with the vertical radius, so the halo rows (which every band filters horizontally on its own) stay a small part of the work.
+#define BITMAP_CONVOLVE_BAND_ROWS 64
+
+//Gaussian blurs above this sigma are approximated by three box filters:
+#define BITMAP_GAUSSIAN_BOX_SIGMA 3.0
+
+//Everything a band needs to know.
+typedef struct {
+	//The views:
+	const bitmap_view_t* input;
+	const bitmap_view_t* output;
+
+	//The size of a single pixel in bytes:
+	uint32_t pixelSize;
+
+	//The kernels (bitmapConvolveView(...) only):
+	const float* kernelX;
+	const float* kernelY;
+
+	//The radii:
+	uint32_t radiusX;
+	uint32_t radiusY;
+
+	//Use the AVX2 kernels?
+	bitmap_bool_t avx2;
+} bitmap_convolve_job_t;
+
+//Processes the output rows [firstRowPx, firstRowPx + rows) of a job. The scratch memory belongs to the calling thread.
+typedef void (*bitmap_band_worker_t)(const bitmap_convolve_job_t* job, uint32_t firstRowPx, uint32_t rows, uint8_t* scratch);
+
+/**********************************************************************************************************************************************************************
+	Helpers
+**********************************************************************************************************************************************************************/
+
+//Internal function that clamps a coordinate to [0, size).
+static inline uint32_t bitmapClampIndex(int64_t index, uint32_t size)
+{
+	return (uint32_t)BITMAP_MIN(BITMAP_MAX(index, 0), (int64_t)size - 1);
+}
+
+//Internal function that rounds and clamps a filtered value to a component.
+static inline uint8_t bitmapClampComponent(float value)
+{
+	value = BITMAP_MIN(BITMAP_MAX(value, 0.0f), 255.0f);
+
+	return (uint8_t)(value + 0.5f);
+}
+
+//Internal function that checks the views of a filter.
+//Returns the size of a single pixel, 0 if the views do not fit together.
+uint32_t bitmapCheckFilterViews(const bitmap_view_t* input, const bitmap_view_t* output)
+{
+	if ((input->pixelFormat != output->pixelFormat) || (input->widthPx != output->widthPx) || (input->heightPx != output->heightPx))
+	{
+		return 0;
+	}
+
+	if (!input->widthPx || !input->heightPx)
+	{
+		return 0;
+	}
+
+	return bitmapPixelFormatSize(input->pixelFormat);
+}
+
+//Internal function that checks for the AVX2 kernels.
+bitmap_bool_t bitmapConvolveAVX2()
+{
+#ifdef BITMAP_X86
+	return __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#else
+	return BITMAP_BOOL_FALSE;
+#endif
+}
+
+//Internal function that runs a job band by band (on all cores, if OpenMP is enabled).
+//Each thread gets scratch memory for the rows of a band plus the halo rows (elementSize bytes per component) and extraBytes on top.
+//
+//Errors:
+//- BITMAP_ERROR_MEMORY  Insufficient memory.
+bitmap_error_t bitmapRunBands(const bitmap_convolve_job_t* job, bitmap_band_worker_t worker, size_t elementSize, size_t extraBytes)
+{
+	uint32_t heightPx = job->input->heightPx;
+	size_t rowComponents = (size_t)job->input->widthPx * job->pixelSize;
+
+	uint32_t bandRows = BITMAP_MAX(BITMAP_CONVOLVE_BAND_ROWS, 4 * job->radiusY);
+	uint32_t bands = (heightPx + bandRows - 1) / bandRows;
+
+	size_t scratchBytes = ((size_t)BITMAP_MIN(bandRows + (2 * job->radiusY), heightPx) * rowComponents * elementSize) + extraBytes;
+	int failed = 0;
+
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		uint8_t* scratch = (uint8_t*)malloc(scratchBytes);
+
+		if (!scratch)
+		{
+#ifdef _OPENMP
+			#pragma omp atomic write
+#endif
+			failed = 1;
+		}
+
+#ifdef _OPENMP
+		#pragma omp for schedule(dynamic)
+#endif
+		for (uint32_t band = 0; band < bands; band++)
+		{
+			if (scratch)
+			{
+				uint32_t firstRowPx = band * bandRows;
+
+				worker(job, firstRowPx, BITMAP_MIN(bandRows, heightPx - firstRowPx), scratch);
+			}
+		}
+
+		free(scratch);
+	}
+
+	return failed ? BITMAP_ERROR_MEMORY : BITMAP_ERROR_SUCCESS;
+}
+
+/**********************************************************************************************************************************************************************
+	Convolution
+**********************************************************************************************************************************************************************/
+
+//Internal horizontal pass over the pixels [firstPx, lastPx) of a row (scalar).
+void bitmapConvolvePixelsHorizontal(const uint8_t* inputRow, float* outputRow, uint32_t widthPx, uint32_t pixelSize, const float* kernel, uint32_t radius, uint32_t firstPx, uint32_t lastPx)
+{
+	for (uint32_t colPx = firstPx; colPx < lastPx; colPx++)
+	{
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			float sum = 0.0f;
+
+			for (uint32_t k = 0; k <= 2 * radius; k++)
+			{
+				uint32_t x = bitmapClampIndex((int64_t)colPx + k - radius, widthPx);
+
+				sum += kernel[k] * inputRow[(x * pixelSize) + c];
+			}
+
+			outputRow[(colPx * pixelSize) + c] = sum;
+		}
+	}
+}
+
+//Internal vertical pass for a single output row (scalar). rows[k] is the horizontally filtered row for the weight k.
+void bitmapConvolveRowVertical(const float** rows, uint8_t* outputRow, size_t components, const float* kernel, uint32_t radius, size_t first)
+{
+	for (size_t i = first; i < components; i++)
+	{
+		float sum = 0.0f;
+
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			sum += kernel[k] * rows[k][i];
+		}
+
+		outputRow[i] = bitmapClampComponent(sum);
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal horizontal pass over a row (AVX2).
+//Away from the edges, 8 components of neighboring pixels are weighted at once (for any pixel size). Same order of operations as the scalar pass, so the results are identical.
+__attribute__((target("avx2")))
+void bitmapConvolveRowHorizontal_AVX2(const uint8_t* inputRow, float* outputRow, uint32_t widthPx, uint32_t pixelSize, const float* kernel, uint32_t radius)
+{
+	if (widthPx <= 2 * radius)
+	{
+		bitmapConvolvePixelsHorizontal(inputRow, outputRow, widthPx, pixelSize, kernel, radius, 0, widthPx);
+		return;
+	}
+
+	//The left edge:
+	bitmapConvolvePixelsHorizontal(inputRow, outputRow, widthPx, pixelSize, kernel, radius, 0, radius);
+
+	//The inner components (all of their neighbors exist):
+	size_t i = (size_t)radius * pixelSize;
+	size_t last = (size_t)(widthPx - radius) * pixelSize;
+
+	for (; i + 8 <= last; i += 8)
+	{
+		__m256 sum = _mm256_setzero_ps();
+
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			__m128i bytes = _mm_loadl_epi64((const __m128i*)&inputRow[i + ((int64_t)k - radius) * pixelSize]);
+
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel[k]), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes))));
+		}
+
+		_mm256_storeu_ps(&outputRow[i], sum);
+	}
+
+	//The rest of the inner components and the right edge (whole pixels, starting with the one that has been cut):
+	bitmapConvolvePixelsHorizontal(inputRow, outputRow, widthPx, pixelSize, kernel, radius, (uint32_t)(i / pixelSize), widthPx);
+}
+
+//Internal vertical pass for a single output row (AVX2).
+__attribute__((target("avx2")))
+void bitmapConvolveRowVertical_AVX2(const float** rows, uint8_t* outputRow, size_t components, const float* kernel, uint32_t radius)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 max = _mm256_set1_ps(255.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	size_t i = 0;
+
+	for (; i + 8 <= components; i += 8)
+	{
+		__m256 sum = _mm256_setzero_ps();
+
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel[k]), _mm256_loadu_ps(&rows[k][i])));
+		}
+
+		//Clamp, round and pack:
+		__m256i values = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sum, zero), max), half));
+		__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+
+		_mm_storel_epi64((__m128i*)&outputRow[i], _mm_packus_epi16(words, words));
+	}
+
+	//The rest of the row:
+	bitmapConvolveRowVertical(rows, outputRow, components, kernel, radius, i);
+}
+#endif
+
+//Internal band worker of bitmapConvolveView(...).
+void bitmapConvolveBand(const bitmap_convolve_job_t* job, uint32_t firstRowPx, uint32_t rows, uint8_t* scratch)
+{
+	uint32_t widthPx = job->input->widthPx;
+	uint32_t heightPx = job->input->heightPx;
+	uint32_t radius = job->radiusY;
+	size_t components = (size_t)widthPx * job->pixelSize;
+
+	//The input rows of the band, including the halo rows:
+	uint32_t firstInputRowPx = (uint32_t)BITMAP_MAX((int64_t)firstRowPx - radius, 0);
+	uint32_t lastInputRowPx = BITMAP_MIN(firstRowPx + rows + radius, heightPx);
+
+	//The window of row pointers comes first (it has the strictest alignment), then the filtered rows:
+	const float** window = (const float**)scratch;
+	float* filtered = (float*)(scratch + (((2 * (size_t)radius) + 1) * sizeof(float*)));
+
+	//Horizontal pass:
+	for (uint32_t rowPx = firstInputRowPx; rowPx < lastInputRowPx; rowPx++)
+	{
+		const uint8_t* inputRow = bitmapViewRow(job->input, rowPx);
+		float* outputRow = &filtered[(size_t)(rowPx - firstInputRowPx) * components];
+
+#ifdef BITMAP_X86
+		if (job->avx2)
+		{
+			bitmapConvolveRowHorizontal_AVX2(inputRow, outputRow, widthPx, job->pixelSize, job->kernelX, job->radiusX);
+			continue;
+		}
+#endif
+
+		bitmapConvolvePixelsHorizontal(inputRow, outputRow, widthPx, job->pixelSize, job->kernelX, job->radiusX, 0, widthPx);
+	}
+
+	//Vertical pass (rows beyond the edges repeat the edge rows):
+	for (uint32_t rowPx = firstRowPx; rowPx < firstRowPx + rows; rowPx++)
+	{
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			window[k] = &filtered[(size_t)(bitmapClampIndex((int64_t)rowPx + k - radius, heightPx) - firstInputRowPx) * components];
+		}
+
+		uint8_t* outputRow = bitmapViewRow(job->output, rowPx);
+
+#ifdef BITMAP_X86
+		if (job->avx2)
+		{
+			bitmapConvolveRowVertical_AVX2(window, outputRow, components, job->kernelY, radius);
+			continue;
+		}
+#endif
+
+		bitmapConvolveRowVertical(window, outputRow, components, job->kernelY, radius, 0);
+	}
+}
+
+//User-accessible.
+bitmap_error_t bitmapConvolveView(const bitmap_view_t* input, const bitmap_view_t* output, const float* kernelX, uint32_t radiusX, const float* kernelY, uint32_t radiusY)
+{
+	bitmap_convolve_job_t job =
+	{
+		.input = input,
+		.output = output,
+		.pixelSize = bitmapCheckFilterViews(input, output),
+		.kernelX = kernelX,
+		.kernelY = kernelY,
+		.radiusX = radiusX,
+		.radiusY = radiusY,
+		.avx2 = bitmapConvolveAVX2()
+	};
+
+	if (!job.pixelSize)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Filtered rows are floats, plus the window of row pointers:
+	return bitmapRunBands(&job, bitmapConvolveBand, sizeof(float), ((2 * (size_t)radiusY) + 1) * sizeof(float*));
+}
+
+/**********************************************************************************************************************************************************************
+	Box filter
+**********************************************************************************************************************************************************************/
+
+//Internal horizontal sliding window over a row.
+//The sum of the window is updated by the pixel that enters and the one that leaves it.
+void bitmapBoxRowHorizontal(const uint8_t* inputRow, uint8_t* outputRow, uint32_t widthPx, uint32_t pixelSize, uint32_t radius, float scale)
+{
+	uint32_t sums[4] = { 0, 0, 0, 0 };
+
+	//The window of the first pixel:
+	for (int64_t x = -(int64_t)radius; x <= (int64_t)radius; x++)
+	{
+		const uint8_t* pixel = &inputRow[bitmapClampIndex(x, widthPx) * pixelSize];
+
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			sums[c] += pixel[c];
+		}
+	}
+
+	for (uint32_t colPx = 0; colPx < widthPx; colPx++)
+	{
+		const uint8_t* entering = &inputRow[bitmapClampIndex((int64_t)colPx + radius + 1, widthPx) * pixelSize];
+		const uint8_t* leaving = &inputRow[bitmapClampIndex((int64_t)colPx - radius, widthPx) * pixelSize];
+
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			outputRow[(colPx * pixelSize) + c] = (uint8_t)((sums[c] * scale) + 0.5f);
+			sums[c] += entering[c] - leaving[c];
+		}
+	}
+}
+
+//Internal vertical sliding window step for a single output row (scalar).
+//Writes the mean of the column sums, then moves the window down by a row.
+void bitmapBoxRowVertical(uint32_t* sums, const uint8_t* entering, const uint8_t* leaving, uint8_t* outputRow, size_t components, float scale, size_t first)
+{
+	for (size_t i = first; i < components; i++)
+	{
+		outputRow[i] = (uint8_t)((sums[i] * scale) + 0.5f);
+		sums[i] += entering[i] - leaving[i];
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal vertical sliding window step for a single output row (AVX2, 8 column sums at once).
+__attribute__((target("avx2")))
+void bitmapBoxRowVertical_AVX2(uint32_t* sums, const uint8_t* entering, const uint8_t* leaving, uint8_t* outputRow, size_t components, float scale)
+{
+	const __m256 scales = _mm256_set1_ps(scale);
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	size_t i = 0;
+
+	for (; i + 8 <= components; i += 8)
+	{
+		__m256i sum = _mm256_loadu_si256((const __m256i*)&sums[i]);
+
+		//The mean (the sums are never negative and the means never exceed 255, so the packs do not clamp):
+		__m256i values = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), scales), half));
+		__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+
+		_mm_storel_epi64((__m128i*)&outputRow[i], _mm_packus_epi16(words, words));
+
+		//Move the window:
+		__m256i in = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&entering[i]));
+		__m256i out = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&leaving[i]));
+
+		_mm256_storeu_si256((__m256i*)&sums[i], _mm256_sub_epi32(_mm256_add_epi32(sum, in), out));
+	}
+
+	//The rest of the row:
+	bitmapBoxRowVertical(sums, entering, leaving, outputRow, components, scale, i);
+}
+#endif
+
+//Internal band worker of bitmapBoxBlurView(...).
+void bitmapBoxBand(const bitmap_convolve_job_t* job, uint32_t firstRowPx, uint32_t rows, uint8_t* scratch)
+{
+	uint32_t widthPx = job->input->widthPx;
+	uint32_t heightPx = job->input->heightPx;
+	uint32_t radius = job->radiusY;
+	size_t components = (size_t)widthPx * job->pixelSize;
+
+	float scaleX = 1.0f / ((2 * job->radiusX) + 1);
+	float scaleY = 1.0f / ((2 * radius) + 1);
+
+	//The input rows of the band, including the halo rows:
+	uint32_t firstInputRowPx = (uint32_t)BITMAP_MAX((int64_t)firstRowPx - radius, 0);
+	uint32_t lastInputRowPx = BITMAP_MIN(firstRowPx + rows + radius + 1, heightPx);
+
+	//The column sums come first, then the filtered rows:
+	uint32_t* sums = (uint32_t*)scratch;
+	uint8_t* filtered = scratch + (components * sizeof(uint32_t));
+
+	//Horizontal pass:
+	for (uint32_t rowPx = firstInputRowPx; rowPx < lastInputRowPx; rowPx++)
+	{
+		bitmapBoxRowHorizontal(bitmapViewRow(job->input, rowPx), &filtered[(size_t)(rowPx - firstInputRowPx) * components], widthPx, job->pixelSize, job->radiusX, scaleX);
+	}
+
+	//The column sums of the window of the first row (rows beyond the edges repeat the edge rows):
+	memset(sums, 0, components * sizeof(uint32_t));
+
+	for (int64_t y = (int64_t)firstRowPx - radius; y <= (int64_t)firstRowPx + radius; y++)
+	{
+		const uint8_t* row = &filtered[(size_t)(bitmapClampIndex(y, heightPx) - firstInputRowPx) * components];
+
+		for (size_t i = 0; i < components; i++)
+		{
+			sums[i] += row[i];
+		}
+	}
+
+	//Vertical pass:
+	for (uint32_t rowPx = firstRowPx; rowPx < firstRowPx + rows; rowPx++)
+	{
+		const uint8_t* entering = &filtered[(size_t)(bitmapClampIndex((int64_t)rowPx + radius + 1, heightPx) - firstInputRowPx) * components];
+		const uint8_t* leaving = &filtered[(size_t)(bitmapClampIndex((int64_t)rowPx - radius, heightPx) - firstInputRowPx) * components];
+		uint8_t* outputRow = bitmapViewRow(job->output, rowPx);
+
+#ifdef BITMAP_X86
+		if (job->avx2)
+		{
+			bitmapBoxRowVertical_AVX2(sums, entering, leaving, outputRow, components, scaleY);
+			continue;
+		}
+#endif
+
+		bitmapBoxRowVertical(sums, entering, leaving, outputRow, components, scaleY, 0);
+	}
+}
+
+//User-accessible.
+bitmap_error_t bitmapBoxBlurView(const bitmap_view_t* input, const bitmap_view_t* output, uint32_t radiusX, uint32_t radiusY)
+{
+	bitmap_convolve_job_t job =
+	{
+		.input = input,
+		.output = output,
+		.pixelSize = bitmapCheckFilterViews(input, output),
+		.radiusX = radiusX,
+		.radiusY = radiusY,
+		.avx2 = bitmapConvolveAVX2()
+	};
+
+	if (!job.pixelSize)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Filtered rows are bytes (plus one row, the last step moves the window past the band), plus the column sums:
+	return bitmapRunBands(&job, bitmapBoxBand, 1, ((size_t)input->widthPx * job.pixelSize * (1 + sizeof(uint32_t))));
+}
+
+/**********************************************************************************************************************************************************************
+	Gaussian blur and sharpening
+**********************************************************************************************************************************************************************/
+
+//Internal function that computes the radii of three box filters that come close to a Gaussian blur with the given sigma.
+//The widths are the two odd numbers around the ideal width, mixed so the variance matches.
+void bitmapGaussianBoxRadii(double sigma, uint32_t radii[3])
+{
+	double idealWidth = sqrt((12.0 * sigma * sigma / 3.0) + 1.0);
+
+	int32_t lowerWidth = (int32_t)floor(idealWidth);
+
+	if (!(lowerWidth % 2))
+	{
+		lowerWidth--;
+	}
+
+	int32_t upperWidth = lowerWidth + 2;
+
+	//How many boxes use the lower width?
+	double lowerCount = ((12.0 * sigma * sigma) - (3.0 * lowerWidth * lowerWidth) - (12.0 * lowerWidth) - 9.0) / ((-4.0 * lowerWidth) - 4.0);
+
+	for (int32_t i = 0; i < 3; i++)
+	{
+		radii[i] = (uint32_t)(((i < lround(lowerCount)) ? lowerWidth : upperWidth) - 1) / 2;
+	}
+}
+
+//User-accessible.
+bitmap_error_t bitmapGaussianBlurView(const bitmap_view_t* input, const bitmap_view_t* output, double sigma)
+{
+	uint32_t pixelSize = bitmapCheckFilterViews(input, output);
+
+	if (!pixelSize || !(sigma > 0.0))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Small sigmas: a real Gaussian kernel (three sigmas on both sides):
+	if (sigma <= BITMAP_GAUSSIAN_BOX_SIGMA)
+	{
+		uint32_t radius = (uint32_t)ceil(3.0 * sigma);
+		float* kernel = (float*)malloc(((2 * radius) + 1) * sizeof(float));
+
+		if (!kernel)
+		{
+			return BITMAP_ERROR_MEMORY;
+		}
+
+		double sum = 0.0;
+
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			double x = (double)k - radius;
+			kernel[k] = (float)exp(-(x * x) / (2.0 * sigma * sigma));
+			sum += kernel[k];
+		}
+
+		for (uint32_t k = 0; k <= 2 * radius; k++)
+		{
+			kernel[k] = (float)(kernel[k] / sum);
+		}
+
+		success = bitmapConvolveView(input, output, kernel, radius, kernel, radius);
+		free(kernel);
+
+		return success;
+	}
+
+	//Big sigmas: three box filters (input -> output -> temporary -> output):
+	uint32_t radii[3];
+	bitmapGaussianBoxRadii(sigma, radii);
+
+	void* data = malloc((size_t)input->widthPx * input->heightPx * pixelSize);
+
+	if (!data)
+	{
+		return BITMAP_ERROR_MEMORY;
+	}
+
+	bitmap_view_t temporary = bitmapViewFromBuffer(data, input->widthPx, input->heightPx, input->pixelFormat);
+
+	if ((success = bitmapBoxBlurView(input, output, radii[0], radii[0])) == BITMAP_ERROR_SUCCESS)
+	{
+		if ((success = bitmapBoxBlurView(output, &temporary, radii[1], radii[1])) == BITMAP_ERROR_SUCCESS)
+		{
+			success = bitmapBoxBlurView(&temporary, output, radii[2], radii[2]);
+		}
+	}
+
+	free(data);
+
+	return success;
+}
+
+//User-accessible.
+bitmap_error_t bitmapSharpenView(const bitmap_view_t* input, const bitmap_view_t* output, double sigma, double amount)
+{
+	//Status var:
+	bitmap_error_t success;
+
+	//Blur into the output first:
+	if ((success = bitmapGaussianBlurView(input, output, sigma)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	//Then push every component away from its blurred value:
+	size_t components = (size_t)input->widthPx * bitmapPixelFormatSize(input->pixelFormat);
+	float factor = (float)amount;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < input->heightPx; rowPx++)
+	{
+		const uint8_t* inputRow = bitmapViewRow(input, rowPx);
+		uint8_t* outputRow = bitmapViewRow(output, rowPx);
+
+		for (size_t i = 0; i < components; i++)
+		{
+			outputRow[i] = bitmapClampComponent(inputRow[i] + (factor * (inputRow[i] - outputRow[i])));
+		}
+	}
+
+	return BITMAP_ERROR_SUCCESS;
+}
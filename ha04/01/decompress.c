@@ -42,28 +42,26 @@ static void perform_inverse_dct(const float* input_block, float* output_block, f
 
 }
 
-// Copy the block at (`index_x`, `index_y`) from `block` into the given pixel buffer.
-// The dimensions of the image (in blocks) is given by `blocks_x` * `blocks_y`.
-static void write_block(bitmap_pixel_rgb_t *pixels, uint32_t index_x, uint32_t index_y, uint32_t blocks_x, uint32_t blocks_y, const float *block)
+// Copy the block at (`index_x`, `index_y`) from `block` into the given view.
+// The view can be any crop of a bitmap, as long as it covers whole blocks.
+static void write_block(const bitmap_view_t *view, uint32_t index_x, uint32_t index_y, const float *block)
 {
-	uint32_t bytes_per_row = blocks_x * 8;
-	uint32_t base_offset = index_y * 8 * bytes_per_row;
 	uint32_t col_offset = index_x * 8;
 
 	for (uint32_t curr_y = 0; curr_y < 8; curr_y++)
 	{
-		uint32_t rowOffset = curr_y * bytes_per_row;
+		bitmap_pixel_rgb_t *row = (bitmap_pixel_rgb_t*)bitmapViewRow(view, (index_y * 8) + curr_y);
 
 		for (uint32_t curr_x = 0; curr_x < 8; curr_x++)
 		{
-			uint32_t offset = base_offset + rowOffset + col_offset + curr_x;
+			uint32_t offset = col_offset + curr_x;
 			float component = roundf(block[(8 * curr_y) + curr_x]) + 128;
 
 			bitmap_component_t clamped_component = (bitmap_component_t)MAX(0, MIN(component, 255));
 
-			pixels[offset].r = clamped_component;
-			pixels[offset].g = clamped_component;
-			pixels[offset].b = clamped_component;
+			row[offset].r = clamped_component;
+			row[offset].g = clamped_component;
+			row[offset].b = clamped_component;
 		}
 	}
 }
@@ -85,6 +83,7 @@ int decompress(const char* file_path, const uint32_t* quant_matrix, const char*
 	fread(&blocks_y, sizeof(uint32_t), 1, input_file);
 
 	bitmap_pixel_rgb_t *pixels = malloc(sizeof(bitmap_pixel_rgb_t) * blocks_x * blocks_y * 64);
+	bitmap_view_t view = bitmapViewFromPixels((bitmap_pixel_t*)pixels, blocks_x * 8, blocks_y * 8);
 
 	// Walk all the blocks:
 	for (uint32_t index_y = 0; index_y < blocks_y; index_y++)
@@ -101,7 +100,7 @@ int decompress(const char* file_path, const uint32_t* quant_matrix, const char*
 			dequantize(un_zig_zagged, quant_matrix, de_quantized);
 			perform_inverse_dct(de_quantized, inverse_dct, cosine_values);
 
-			write_block(pixels, index_x, index_y, blocks_x, blocks_y, inverse_dct);
+			write_block(&view, index_x, index_y, inverse_dct);
 		}
 	}
 
@@ -115,16 +114,23 @@ int decompress(const char* file_path, const uint32_t* quant_matrix, const char*
         .colorSpace = BITMAP_COLOR_SPACE_RGB
     };
 
-    // write the pixels back
-    bitmap_error_t error = bitmapWritePixels(
-        output_path,
-        BITMAP_BOOL_TRUE,
-        &params,
-        (bitmap_pixel_t*)pixels
-    );
+    // write the pixels back (a raw frame to stdout if the path is "-", which runs from the top row down)
+    bitmap_error_t error;
+
+    if (strcmp(output_path, "-") == 0) {
+        bitmap_view_t rows = bitmapViewFlipVertical(view);
+        error = bitmapWriteFrame(stdout, &rows, BITMAP_COLOR_SPACE_RGB);
+    } else {
+        error = bitmapWriteView(
+            output_path,
+            BITMAP_BOOL_TRUE,
+            &params,
+            &view
+        );
+    }
 
 	free(pixels);
 	fclose(input_file);
 
-	return 0;
+	return (error == BITMAP_ERROR_SUCCESS) ? 0 : -1;
 }
@@ -26,6 +26,12 @@ int main(int argc, char** argv)
 	// Quantization factor (percent):
 	int quantization_factor = -1;
 
+	// Orientation of the input bitmap (compression only):
+	bitmap_orientation_t orientation = -1;
+
+	// Sigma of the Gaussian pre-blur (compression only):
+	double blur_sigma = 0.0;
+
 	// Iterate over the input parameters:
 	for (int i = 1; i < argc; i++)
 	{
@@ -73,6 +79,38 @@ int main(int argc, char** argv)
 
 			compression_mode = 0;
 		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			// Make sure there is at least one more parameter:
+			if ((argc - 1 - i) < 1)
+			{
+				printf("-t option needs one parameter: <orientation> (rotate90, rotate180, rotate270, transpose, fliph or flipv)\n");
+				return -1;
+			}
+
+			if (!bitmapParseOrientation(argv[++i], &orientation))
+			{
+				printf("Unknown orientation: %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "-g") == 0)
+		{
+			// Make sure there is at least one more parameter:
+			if ((argc - 1 - i) < 1)
+			{
+				printf("-g option needs one parameter: <sigma>\n");
+				return -1;
+			}
+
+			blur_sigma = atof(argv[++i]);
+
+			if (blur_sigma <= 0.0)
+			{
+				printf("Sigma must be positive.\n");
+				return -1;
+			}
+		}
 		else if (strcmp(argv[i], "-q") == 0)
 		{
 			// Is there already a quantization factor?
@@ -125,7 +163,9 @@ int main(int argc, char** argv)
 		// file_path1: Input path to bitmap
 		// file_path2: Output path to grayscale bitmap
 		// file_path3: Output path to compressed blob
-		return compress(file_path1, quant_matrix, file_path2, file_path3);
+		// orientation: Turns the bitmap first (clockwise), unless -1
+		// blur_sigma: Blurs the bitmap before compressing it, unless 0
+		return compress(file_path1, quant_matrix, file_path2, file_path3, orientation, blur_sigma);
 	}
 	else
 	{
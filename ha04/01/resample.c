@@ -0,0 +1,469 @@
+#include "resample.h"
+
+//Min / max:
+#define BITMAP_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BITMAP_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+//Includes from the standard library:
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//SIMD intrinsics (x86 only, everything else takes the scalar paths):
+#if defined(__x86_64__) || defined(__i386__)
+#define BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+//Weights are fixed point numbers with this many fractional bits (the weights of one output pixel sum up to 1 << BITMAP_RESAMPLE_BITS):
+#define BITMAP_RESAMPLE_BITS 14
+#define BITMAP_RESAMPLE_ROUNDING (1 << (BITMAP_RESAMPLE_BITS - 1))
+
+//The weights of one axis.
+//Output pixel i is the weighted sum of count[i] input pixels, starting at start[i].
+typedef struct {
+	//The first input pixel per output pixel:
+	uint32_t* start;
+
+	//The number of input pixels per output pixel:
+	uint32_t* count;
+
+	//maxTaps weights per output pixel (unused ones are 0):
+	int16_t* weights;
+
+	//The maximum number of input pixels per output pixel:
+	uint32_t maxTaps;
+} bitmap_resample_axis_t;
+
+/**********************************************************************************************************************************************************************
+	Filters
+**********************************************************************************************************************************************************************/
+
+//Internal function that returns how far a filter reaches (in input pixels, when not downscaling).
+double bitmapFilterSupport(bitmap_filter_t filter)
+{
+	switch (filter)
+	{
+	case BITMAP_FILTER_BICUBIC:
+
+		return 2.0;
+
+	case BITMAP_FILTER_LANCZOS:
+
+		return 3.0;
+
+	default:
+
+		return 1.0;
+	}
+}
+
+//Internal function that evaluates sin(pi * x) / (pi * x).
+double bitmapSinc(double x)
+{
+	if (x == 0.0)
+	{
+		return 1.0;
+	}
+
+	x *= M_PI;
+
+	return sin(x) / x;
+}
+
+//Internal function that evaluates a filter at the distance x.
+double bitmapFilterWeight(bitmap_filter_t filter, double x)
+{
+	x = fabs(x);
+
+	switch (filter)
+	{
+	case BITMAP_FILTER_BICUBIC:
+	{
+		//Keys cubic with a = -0.5:
+		const double a = -0.5;
+
+		if (x < 1.0)
+		{
+			return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+		}
+
+		if (x < 2.0)
+		{
+			return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+		}
+
+		return 0.0;
+	}
+
+	case BITMAP_FILTER_LANCZOS:
+
+		return (x < 3.0) ? (bitmapSinc(x) * bitmapSinc(x / 3.0)) : 0.0;
+
+	default:
+
+		//Triangle:
+		return (x < 1.0) ? (1.0 - x) : 0.0;
+	}
+}
+
+//User-accessible.
+bitmap_bool_t bitmapParseFilter(const char* name, bitmap_filter_t* filter)
+{
+	if (strcmp(name, "bilinear") == 0)
+	{
+		*filter = BITMAP_FILTER_BILINEAR;
+	}
+	else if (strcmp(name, "bicubic") == 0)
+	{
+		*filter = BITMAP_FILTER_BICUBIC;
+	}
+	else if (strcmp(name, "lanczos") == 0)
+	{
+		*filter = BITMAP_FILTER_LANCZOS;
+	}
+	else
+	{
+		return BITMAP_BOOL_FALSE;
+	}
+
+	return BITMAP_BOOL_TRUE;
+}
+
+/**********************************************************************************************************************************************************************
+	Weight tables
+**********************************************************************************************************************************************************************/
+
+//Internal function that releases the weights of an axis.
+void bitmapFreeResampleAxis(bitmap_resample_axis_t* axis)
+{
+	free(axis->start);
+	free(axis->count);
+	free(axis->weights);
+}
+
+//Internal function that computes the weights of an axis (from inputSize pixels to outputSize pixels).
+//
+//Errors:
+//- BITMAP_ERROR_MEMORY  Insufficient memory.
+//
+//If the function succeeds, the axis must be released.
+bitmap_error_t bitmapBuildResampleAxis(bitmap_resample_axis_t* axis, uint32_t inputSize, uint32_t outputSize, bitmap_filter_t filter)
+{
+	//When downscaling, the filter is stretched over more input pixels:
+	double scale = (double)inputSize / outputSize;
+	double filterScale = BITMAP_MAX(scale, 1.0);
+	double support = bitmapFilterSupport(filter) * filterScale;
+
+	axis->maxTaps = (uint32_t)ceil(support) * 2 + 1;
+	axis->start = (uint32_t*)malloc(outputSize * sizeof(uint32_t));
+	axis->count = (uint32_t*)malloc(outputSize * sizeof(uint32_t));
+	axis->weights = (int16_t*)calloc((size_t)outputSize * axis->maxTaps, sizeof(int16_t));
+
+	double* weights = (double*)malloc(axis->maxTaps * sizeof(double));
+
+	if (!axis->start || !axis->count || !axis->weights || !weights)
+	{
+		bitmapFreeResampleAxis(axis);
+		free(weights);
+
+		return BITMAP_ERROR_MEMORY;
+	}
+
+	for (uint32_t i = 0; i < outputSize; i++)
+	{
+		//The center of the output pixel in input coordinates:
+		double center = (i + 0.5) * scale;
+
+		int64_t first = BITMAP_MAX(0, (int64_t)floor(center - support + 0.5));
+		int64_t last = BITMAP_MIN((int64_t)inputSize, (int64_t)floor(center + support + 0.5));
+		uint32_t count = (uint32_t)BITMAP_MIN((int64_t)axis->maxTaps, BITMAP_MAX(1, last - first));
+
+		first = BITMAP_MIN(first, (int64_t)inputSize - count);
+
+		//Evaluate the filter and normalize:
+		double sum = 0.0;
+
+		for (uint32_t k = 0; k < count; k++)
+		{
+			weights[k] = bitmapFilterWeight(filter, (first + k + 0.5 - center) / filterScale);
+			sum += weights[k];
+		}
+
+		//Convert to fixed point, the rounding error goes to the biggest weight (the sum must stay exact):
+		int16_t* fixedWeights = &axis->weights[(size_t)i * axis->maxTaps];
+		int32_t fixedSum = 0;
+		uint32_t biggest = 0;
+
+		for (uint32_t k = 0; k < count; k++)
+		{
+			fixedWeights[k] = (int16_t)lround((sum != 0.0 ? weights[k] / sum : 1.0 / count) * (1 << BITMAP_RESAMPLE_BITS));
+			fixedSum += fixedWeights[k];
+
+			if (fixedWeights[k] > fixedWeights[biggest])
+			{
+				biggest = k;
+			}
+		}
+
+		fixedWeights[biggest] += (1 << BITMAP_RESAMPLE_BITS) - fixedSum;
+
+		axis->start[i] = (uint32_t)first;
+		axis->count[i] = count;
+	}
+
+	free(weights);
+
+	return BITMAP_ERROR_SUCCESS;
+}
+
+/**********************************************************************************************************************************************************************
+	Passes
+**********************************************************************************************************************************************************************/
+
+//Internal function that clamps a fixed point sum to a component.
+static inline uint8_t bitmapResampleClamp(int32_t sum)
+{
+	sum = (sum + BITMAP_RESAMPLE_ROUNDING) >> BITMAP_RESAMPLE_BITS;
+
+	return (uint8_t)BITMAP_MIN(255, BITMAP_MAX(0, sum));
+}
+
+//Internal horizontal pass over a single row (any pixel size).
+void bitmapResampleRowHorizontal(const uint8_t* inputRow, uint8_t* outputRow, const bitmap_resample_axis_t* axis, uint32_t outputWidthPx, uint32_t pixelSize)
+{
+	for (uint32_t colPx = 0; colPx < outputWidthPx; colPx++)
+	{
+		const uint8_t* input = &inputRow[(size_t)axis->start[colPx] * pixelSize];
+		const int16_t* weights = &axis->weights[(size_t)colPx * axis->maxTaps];
+		uint32_t count = axis->count[colPx];
+
+		for (uint32_t c = 0; c < pixelSize; c++)
+		{
+			int32_t sum = 0;
+
+			for (uint32_t k = 0; k < count; k++)
+			{
+				sum += weights[k] * input[(k * pixelSize) + c];
+			}
+
+			outputRow[(colPx * pixelSize) + c] = bitmapResampleClamp(sum);
+		}
+	}
+}
+
+//Internal vertical pass for a single output row.
+//The input rows are "stride" bytes apart, rowBytes bytes of each are combined.
+void bitmapResampleRowVertical(const uint8_t* firstRow, size_t stride, const int16_t* weights, uint32_t count, uint8_t* outputRow, size_t rowBytes)
+{
+	for (size_t i = 0; i < rowBytes; i++)
+	{
+		int32_t sum = 0;
+
+		for (uint32_t k = 0; k < count; k++)
+		{
+			sum += weights[k] * firstRow[(k * stride) + i];
+		}
+
+		outputRow[i] = bitmapResampleClamp(sum);
+	}
+}
+
+#ifdef BITMAP_X86
+//Internal horizontal pass over a single row (BITMAP_PIXEL_FORMAT_32, AVX2).
+//Two input pixels (all four components each) are weighted per step.
+__attribute__((target("avx2")))
+void bitmapResampleRowHorizontal_AVX2(const uint8_t* inputRow, uint8_t* outputRow, const bitmap_resample_axis_t* axis, uint32_t outputWidthPx)
+{
+	const __m128i rounding = _mm_set1_epi32(BITMAP_RESAMPLE_ROUNDING);
+
+	for (uint32_t colPx = 0; colPx < outputWidthPx; colPx++)
+	{
+		const uint8_t* input = &inputRow[(size_t)axis->start[colPx] * 4];
+		const int16_t* weights = &axis->weights[(size_t)colPx * axis->maxTaps];
+		uint32_t count = axis->count[colPx];
+
+		__m256i sum = _mm256_setzero_si256();
+		uint32_t k = 0;
+
+		for (; k + 2 <= count; k += 2)
+		{
+			__m256i pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&input[4 * k]));
+			__m256i pairWeights = _mm256_set_m128i(_mm_set1_epi32(weights[k + 1]), _mm_set1_epi32(weights[k]));
+
+			sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(pixels, pairWeights));
+		}
+
+		__m128i result = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+		//The last odd pixel:
+		if (k < count)
+		{
+			int32_t pixel;
+			memcpy(&pixel, &input[4 * k], sizeof(pixel));
+
+			result = _mm_add_epi32(result, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel)), _mm_set1_epi32(weights[k])));
+		}
+
+		//Round, shift and clamp (the packs saturate):
+		result = _mm_srai_epi32(_mm_add_epi32(result, rounding), BITMAP_RESAMPLE_BITS);
+		result = _mm_packus_epi16(_mm_packs_epi32(result, result), result);
+
+		int32_t pixel = _mm_cvtsi128_si32(result);
+		memcpy(&outputRow[4 * colPx], &pixel, sizeof(pixel));
+	}
+}
+
+//Internal vertical pass for a single output row (AVX2).
+//Two input rows are interleaved and weighted with a single madd, 16 bytes per step.
+__attribute__((target("avx2")))
+void bitmapResampleRowVertical_AVX2(const uint8_t* firstRow, size_t stride, const int16_t* weights, uint32_t count, uint8_t* outputRow, size_t rowBytes)
+{
+	const __m256i rounding = _mm256_set1_epi32(BITMAP_RESAMPLE_ROUNDING);
+	size_t i = 0;
+
+	for (; i + 16 <= rowBytes; i += 16)
+	{
+		__m256i sumLow = _mm256_setzero_si256();
+		__m256i sumHigh = _mm256_setzero_si256();
+
+		for (uint32_t k = 0; k < count; k += 2)
+		{
+			//An odd count pairs the last row with itself and a zero weight:
+			bitmap_bool_t pair = (k + 1 < count);
+
+			__m128i a = _mm_loadu_si128((const __m128i*)&firstRow[(k * stride) + i]);
+			__m128i b = pair ? _mm_loadu_si128((const __m128i*)&firstRow[((k + 1) * stride) + i]) : a;
+
+			uint32_t pairWeights = (uint16_t)weights[k] | ((uint32_t)(uint16_t)(pair ? weights[k + 1] : 0) << 16);
+			__m256i w = _mm256_set1_epi32((int32_t)pairWeights);
+
+			sumLow = _mm256_add_epi32(sumLow, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(a, b)), w));
+			sumHigh = _mm256_add_epi32(sumHigh, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(a, b)), w));
+		}
+
+		sumLow = _mm256_srai_epi32(_mm256_add_epi32(sumLow, rounding), BITMAP_RESAMPLE_BITS);
+		sumHigh = _mm256_srai_epi32(_mm256_add_epi32(sumHigh, rounding), BITMAP_RESAMPLE_BITS);
+
+		//The packs work per 128 bit lane, the permutation restores the order of the bytes:
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(sumLow, sumHigh), 0xD8);
+		__m128i result = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+
+		_mm_storeu_si128((__m128i*)&outputRow[i], result);
+	}
+
+	//The rest of the row:
+	bitmapResampleRowVertical(&firstRow[i], stride, weights, count, &outputRow[i], rowBytes - i);
+}
+#endif
+
+/**********************************************************************************************************************************************************************
+	Resampling
+**********************************************************************************************************************************************************************/
+
+//User-accessible.
+bitmap_error_t bitmapResampleView(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_filter_t filter)
+{
+	uint32_t pixelSize = bitmapPixelFormatSize(input->pixelFormat);
+
+	//Check the views and the filter:
+	if ((input->pixelFormat != output->pixelFormat) || !pixelSize)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	if (!input->widthPx || !input->heightPx || !output->widthPx || !output->heightPx)
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	if ((filter != BITMAP_FILTER_BILINEAR) && (filter != BITMAP_FILTER_BICUBIC) && (filter != BITMAP_FILTER_LANCZOS))
+	{
+		return BITMAP_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	//Status var:
+	bitmap_error_t success;
+
+	//Build the weights of both axes:
+	bitmap_resample_axis_t horizontal;
+	bitmap_resample_axis_t vertical;
+
+	if ((success = bitmapBuildResampleAxis(&horizontal, input->widthPx, output->widthPx, filter)) != BITMAP_ERROR_SUCCESS)
+	{
+		return success;
+	}
+
+	if ((success = bitmapBuildResampleAxis(&vertical, input->heightPx, output->heightPx, filter)) != BITMAP_ERROR_SUCCESS)
+	{
+		bitmapFreeResampleAxis(&horizontal);
+
+		return success;
+	}
+
+	//The horizontal pass goes into an intermediate image (output width, input height):
+	size_t rowBytes = (size_t)output->widthPx * pixelSize;
+	uint8_t* intermediate = (uint8_t*)malloc(rowBytes * input->heightPx);
+
+	if (!intermediate)
+	{
+		bitmapFreeResampleAxis(&horizontal);
+		bitmapFreeResampleAxis(&vertical);
+
+		return BITMAP_ERROR_MEMORY;
+	}
+
+	//Pick the kernels once:
+	bitmap_bool_t avx2 = BITMAP_BOOL_FALSE;
+
+#ifdef BITMAP_X86
+	avx2 = __builtin_cpu_supports("avx2") ? BITMAP_BOOL_TRUE : BITMAP_BOOL_FALSE;
+#endif
+
+	//Horizontal pass, in bands of input rows:
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < input->heightPx; rowPx++)
+	{
+		const uint8_t* inputRow = bitmapViewRow(input, rowPx);
+		uint8_t* outputRow = &intermediate[(size_t)rowPx * rowBytes];
+
+#ifdef BITMAP_X86
+		if (avx2 && (pixelSize == 4))
+		{
+			bitmapResampleRowHorizontal_AVX2(inputRow, outputRow, &horizontal, output->widthPx);
+			continue;
+		}
+#endif
+
+		bitmapResampleRowHorizontal(inputRow, outputRow, &horizontal, output->widthPx, pixelSize);
+	}
+
+	//Vertical pass, in bands of output rows:
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (uint32_t rowPx = 0; rowPx < output->heightPx; rowPx++)
+	{
+		const uint8_t* firstRow = &intermediate[(size_t)vertical.start[rowPx] * rowBytes];
+		const int16_t* weights = &vertical.weights[(size_t)rowPx * vertical.maxTaps];
+		uint8_t* outputRow = bitmapViewRow(output, rowPx);
+
+#ifdef BITMAP_X86
+		if (avx2)
+		{
+			bitmapResampleRowVertical_AVX2(firstRow, rowBytes, weights, vertical.count[rowPx], outputRow, rowBytes);
+			continue;
+		}
+#endif
+
+		bitmapResampleRowVertical(firstRow, rowBytes, weights, vertical.count[rowPx], outputRow, rowBytes);
+	}
+
+	free(intermediate);
+	bitmapFreeResampleAxis(&horizontal);
+	bitmapFreeResampleAxis(&vertical);
+
+	return BITMAP_ERROR_SUCCESS;
+}
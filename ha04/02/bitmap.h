@@ -2,7 +2,9 @@
 #define BITMAP_H
 
 //Includes from the standard library:
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 //Boolean stuff:
 typedef uint8_t bitmap_bool_t;
@@ -53,6 +55,7 @@ typedef int bitmap_compression_t;
 typedef uint8_t bitmap_component_t;
 
 //A single pixel.
+//c3 is the alpha of 32 bit bitmaps. Pixels without an alpha (other color depths, color tables, packed pixels) are read as opaque (0xFF).
 typedef struct {
 	bitmap_component_t c0;
 	bitmap_component_t c1;
@@ -81,6 +84,64 @@ typedef struct {
 	bitmap_component_t c3;
 } bitmap_pixel_hsv_t;
 
+//Packed pixels (3 bytes, no c3).
+//They save a quarter of the memory (and bandwidth) if nobody needs c3.
+typedef struct {
+	bitmap_component_t c0;
+	bitmap_component_t c1;
+	bitmap_component_t c2;
+} bitmap_pixel24_t;
+
+typedef struct {
+	bitmap_component_t r;
+	bitmap_component_t g;
+	bitmap_component_t b;
+} bitmap_pixel_rgb24_t;
+
+typedef struct {
+	bitmap_component_t h;
+	bitmap_component_t s;
+	bitmap_component_t v;
+} bitmap_pixel_hsv24_t;
+
+//The layout of a single pixel in memory (bitmap_pixel_t or bitmap_pixel24_t):
+typedef int bitmap_pixel_format_t;
+
+#define BITMAP_PIXEL_FORMAT_32 0
+#define BITMAP_PIXEL_FORMAT_24 1
+
+//A view onto pixels in memory.
+//This does not own the pixels! Row y starts at (data + y * strideBytes), so crops and flips are just different views onto the same buffer.
+typedef struct {
+	//The first byte of the first row:
+	uint8_t* data;
+
+	//Width in pixels:
+	uint32_t widthPx;
+
+	//Height in pixels:
+	uint32_t heightPx;
+
+	//Distance between the starts of two consecutive rows in bytes (negative for bottom-up walks):
+	int64_t strideBytes;
+
+	//How is a single pixel stored?
+	bitmap_pixel_format_t pixelFormat;
+} bitmap_view_t;
+
+//Options for writing bitmap files (all off by default).
+//They help when lots of big bitmaps are written and the page cache should be left alone.
+typedef struct {
+	//Bypass the page cache (O_DIRECT). Falls back to buffered IO if the file system does not support it:
+	bitmap_bool_t directIO;
+
+	//Reserve the final size of the file before writing (posix_fallocate):
+	bitmap_bool_t preallocate;
+
+	//Drop the written pages from the page cache when the file is complete (posix_fadvise):
+	bitmap_bool_t dropCache;
+} bitmap_write_options_t;
+
 //Parameters for bitmap creation.
 //This is our own format! We convert it dynamically from / to the actual bitmap.
 typedef struct {
@@ -113,6 +174,12 @@ typedef struct {
 
 	//The color table:
 	bitmap_pixel_t colorTable[256 * sizeof(bitmap_pixel_t)];
+
+	//How the file is written (ignored when reading):
+	bitmap_write_options_t writeOptions;
+
+	//The pixel format the user provides (bitmapTransform(...) and bitmapWriteBands(...) only, views bring their own):
+	bitmap_pixel_format_t pixelFormat;
 } bitmap_parameters_t;
 
 //Bitmap errors:
@@ -124,6 +191,12 @@ typedef int bitmap_error_t;
 #define BITMAP_ERROR_IO                  3
 #define BITMAP_ERROR_MEMORY              4
 #define BITMAP_ERROR_FILE_EXISTS         5
+#define BITMAP_ERROR_END_OF_STREAM       6
+
+//Callback for bitmapTransform(...) and bitmapWriteBands(...).
+//Processes a band of rows in place (resp. fills it). The first row of the band has the index firstRowPx in the image.
+//Anything but BITMAP_ERROR_SUCCESS stops the writing at this band, the error is passed on to the caller (the file is left incomplete).
+typedef bitmap_error_t (*bitmap_row_callback_t)(bitmap_view_t* band, uint32_t firstRowPx, void* userData);
 
 /**********************************************************************************************************************************************************************
 	Read an existing bitmap file.
@@ -138,6 +211,23 @@ typedef int bitmap_error_t;
 
 bitmap_error_t bitmapReadPixels(const char* filePath, bitmap_pixel_t** pixels, uint32_t* widthPx, uint32_t* heightPx, bitmap_color_space_t colorSpace);
 
+/**********************************************************************************************************************************************************************
+	Read an existing bitmap file into a view with the given pixel format.
+	If the function returns successfully, the allocated buffer (view->data) must be released.
+
+	Errors: See bitmapReadPixels(...). An unknown pixel format is reported as BITMAP_ERROR_INVALID_FILE_FORMAT.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapReadView(const char* filePath, bitmap_view_t* view, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat);
+
+/**********************************************************************************************************************************************************************
+	Read the parameters of an existing bitmap file (dimensions, orientation, color depth etc.) without its pixels.
+
+	Errors: See bitmapReadPixels(...).
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapReadParameters(const char* filePath, bitmap_parameters_t* parameters);
+
 /**********************************************************************************************************************************************************************
 	Write a bitmap file. Use the provided bitmap parameters.
 
@@ -151,4 +241,144 @@ bitmap_error_t bitmapReadPixels(const char* filePath, bitmap_pixel_t** pixels, u
 
 bitmap_error_t bitmapWritePixels(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_pixel_t* pixels);
 
+/**********************************************************************************************************************************************************************
+	Write a bitmap file from a view. Use the provided bitmap parameters, but take the dimensions and the pixel format from the view.
+	The view may be cropped or flipped, no copy of the pixels is made.
+
+	Errors: See bitmapWritePixels(...).
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapWriteView(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, const bitmap_view_t* view);
+
+/**********************************************************************************************************************************************************************
+	Write a bitmap file band by band. Use the provided bitmap parameters (including the dimensions and the pixel format).
+	The row callback fills each band of rows (the pixels are uninitialized when it gets them), which is encoded right away while it is still in the cache.
+	This way, pixels can be generated or rearranged (e.g. rotated) on the fly, without building the whole image in memory first.
+	All bands but the last one have the same height, which is a multiple of 8 rows.
+
+	Errors: See bitmapWritePixels(...). An unknown pixel format is reported as BITMAP_ERROR_INVALID_FILE_FORMAT.
+	        An error of the row callback (e.g. a failed read of the pixels it fills the band with) stops the writing and is returned as it is.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapWriteBands(const char* filePath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, bitmap_row_callback_t rowCallback, void* userData);
+
+/**********************************************************************************************************************************************************************
+	Transform a bitmap file into another one, band by band.
+	Each band of rows is decoded into the color space and the pixel format of the parameters, handed to the row callback (which works in place) and encoded right away.
+	This keeps the rows in the cache, instead of walking the whole image three times (read, process, write).
+	With OpenMP, the bands grow with the number of threads (omp_get_max_threads()), so the callback can split them up between the threads.
+
+	The dimensions and the orientation of the output are taken from the input and are stored into the parameters.
+	Only BITMAP_COMPRESSION_NONE is supported on both sides.
+
+	Errors: See bitmapReadPixels(...) and bitmapWritePixels(...). An error of the row callback stops the transform and is returned as it is.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapTransform(const char* inPath, const char* outPath, bitmap_bool_t overwriteExisting, bitmap_parameters_t* parameters, bitmap_row_callback_t rowCallback, void* userData);
+
+/**********************************************************************************************************************************************************************
+	Read a bitmap file band by band, so only a band of rows has to be in memory at once (e.g. to combine several files row by row).
+	bitmapOpenBands(...) reads the header, stores the parameters of the file into "parameters" and returns a reader for the given color space and pixel format.
+	bitmapReadBand(...) decodes the next band->heightPx rows into the band, in the order of the file like bitmapReadView(...) (the band has the width of the bitmap and the pixel format of the reader).
+	bitmapCloseBands(...) closes the file and releases the reader (NULL is allowed).
+	Only BITMAP_COMPRESSION_NONE is supported.
+
+	Errors: See bitmapReadPixels(...). In addition:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The band does not match the bitmap.
+	- BITMAP_ERROR_END_OF_STREAM        Fewer rows are left than the band has (nothing is read).
+**********************************************************************************************************************************************************************/
+
+//A bitmap file that is read band by band:
+typedef struct bitmap_band_reader_s bitmap_band_reader_t;
+
+bitmap_error_t bitmapOpenBands(const char* filePath, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat, bitmap_parameters_t* parameters, bitmap_band_reader_t** reader);
+bitmap_error_t bitmapReadBand(bitmap_band_reader_t* reader, const bitmap_view_t* band);
+void bitmapCloseBands(bitmap_band_reader_t* reader);
+
+/**********************************************************************************************************************************************************************
+	Views.
+	All of these functions only change the metadata of a view and never touch (or copy) the pixels.
+**********************************************************************************************************************************************************************/
+
+//The size of a single pixel in bytes (0 for unknown pixel formats).
+uint32_t bitmapPixelFormatSize(bitmap_pixel_format_t pixelFormat);
+
+//A view onto a contiguous, top-to-bottom pixel buffer (as returned by bitmapReadPixels(...)).
+bitmap_view_t bitmapViewFromPixels(bitmap_pixel_t* pixels, uint32_t widthPx, uint32_t heightPx);
+
+//A view onto a contiguous, top-to-bottom pixel buffer with the given pixel format.
+bitmap_view_t bitmapViewFromBuffer(void* data, uint32_t widthPx, uint32_t heightPx, bitmap_pixel_format_t pixelFormat);
+
+//Crop a view to the given rectangle. The rectangle is clamped to the view.
+bitmap_view_t bitmapViewCrop(bitmap_view_t view, uint32_t xPx, uint32_t yPx, uint32_t widthPx, uint32_t heightPx);
+
+//Flip a view vertically (the last row becomes the first one).
+bitmap_view_t bitmapViewFlipVertical(bitmap_view_t view);
+
+//Keep every step-th row of a view, starting with the first one (e.g. to sample an image).
+bitmap_view_t bitmapViewSkipRows(bitmap_view_t view, uint32_t step);
+
+//Get the first byte of the given row.
+uint8_t* bitmapViewRow(const bitmap_view_t* view, uint32_t rowPx);
+
+/**********************************************************************************************************************************************************************
+	Converting between pixel formats.
+	Packing drops c3, unpacking sets it to 0xFF (opaque). The buffers must not overlap.
+**********************************************************************************************************************************************************************/
+
+void bitmapPackPixels(const bitmap_pixel_t* pixels, bitmap_pixel24_t* packed, size_t count);
+
+void bitmapUnpackPixels(const bitmap_pixel24_t* packed, bitmap_pixel_t* pixels, size_t count);
+
+/**********************************************************************************************************************************************************************
+	Brightness of RGB pixels.
+	Scales R, G and B of every pixel by valueTable[V] / V (V = max(R, G, B)) and rounds to the nearest value, c3 stays as it is.
+	This sets V of HSV to valueTable[V] and keeps H and S, without converting to HSV and back (black pixels turn gray with the value valueTable[0]).
+	Works in place on both pixel formats, 8 pixels at once with AVX2 (if available).
+**********************************************************************************************************************************************************************/
+
+void bitmapScaleBrightness(const bitmap_view_t* view, const uint8_t* valueTable);
+
+/**********************************************************************************************************************************************************************
+	Histogram of the values of a view: histogram[v] (256 entries) is the number of pixels whose largest component in the mask is v.
+	With only the bit of V set (0x4), this counts V of HSV pixels, with the bits of R, G and B (0x7) V = max(R, G, B) of RGB pixels.
+	Every thread counts its rows into private histograms (4 of them, so that neighbouring pixels with the same value do not wait for each other's stores), all are added up at the end.
+**********************************************************************************************************************************************************************/
+
+void bitmapValueHistogram(const bitmap_view_t* view, uint32_t componentMask, uint32_t* histogram);
+
+/**********************************************************************************************************************************************************************
+	Raw frames.
+	A frame is a fixed header, followed by tightly packed rows (top to bottom). There is nothing to parse, swizzle or unpad, so tools can pass frames through pipes.
+	The rows of a frame are always in picture order, unlike the rows of a file. A view of a bottom-up bitmap (as read, bottom row first) is flipped with
+	bitmapViewFlipVertical() before it is written as a frame (which costs nothing), and a frame is written to a file as a top-down bitmap (or flipped back).
+	The header has six uint32_t fields (in the byte order of the machine): "BMFR", width, height, pixel format, color space, stride in bytes (between two rows).
+	Any number of frames can follow each other in a stream.
+**********************************************************************************************************************************************************************/
+
+/**********************************************************************************************************************************************************************
+	Read the next frame from a stream (e.g. stdin) into a view with the given color space and pixel format.
+	If they match the ones of the frame, the rows are read straight into the view. Otherwise, they are converted.
+	If the function returns successfully, the allocated buffer (view->data) must be released.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The stream does not contain a valid frame (or the pixel format is unknown).
+	- BITMAP_ERROR_IO                   An IO error has occurred. Includes truncated frames.
+	- BITMAP_ERROR_MEMORY               Insufficient memory.
+	- BITMAP_ERROR_END_OF_STREAM        The stream ended before the frame (no more frames).
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapReadFrame(FILE* stream, bitmap_view_t* view, bitmap_color_space_t colorSpace, bitmap_pixel_format_t pixelFormat);
+
+/**********************************************************************************************************************************************************************
+	Write a view as a frame to a stream (e.g. stdout). The color space tells what the pixels of the view are.
+	The view may be cropped or flipped, the rows of the frame are always tightly packed.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The pixel format of the view is unknown.
+	- BITMAP_ERROR_IO                   An IO error has occurred.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapWriteFrame(FILE* stream, const bitmap_view_t* view, bitmap_color_space_t colorSpace);
+
 #endif
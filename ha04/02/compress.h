@@ -1,7 +1,10 @@
 #ifndef COMPRESS_H
 #define COMPRESS_H
 
+#include "rotate.h"
+
 // Compress the given bitmap file.
-int compress(const char* file_path, const uint32_t* quant_matrix, const char* grayscale_path, const char* output_path);
+// The bitmap is turned first, unless the orientation is -1. Then it is blurred (Gaussian), unless the sigma is 0.
+int compress(const char* file_path, const uint32_t* quant_matrix, const char* grayscale_path, const char* output_path, bitmap_orientation_t orientation, double blur_sigma);
 
 #endif
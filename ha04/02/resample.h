@@ -0,0 +1,31 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+//Resampling builds on top of the bitmap library:
+#include "bitmap.h"
+
+//The filter used for resampling:
+typedef int bitmap_filter_t;
+
+#define BITMAP_FILTER_BILINEAR 0
+#define BITMAP_FILTER_BICUBIC 1
+#define BITMAP_FILTER_LANCZOS 2
+
+/**********************************************************************************************************************************************************************
+	Resample a view to the size of another one (separable: a horizontal pass, then a vertical pass).
+	The weights of both axes are computed once up front and applied in fixed point (AVX2 if available). Rows are processed in bands on all cores (OpenMP, if enabled).
+
+	Both views must have the same pixel format. All components are resampled independently, so this fits RGB pixels best (hue does not interpolate well).
+	The output view must point to enough memory for its dimensions, the input view is not changed.
+
+	Errors:
+	- BITMAP_ERROR_INVALID_FILE_FORMAT  The pixel formats differ or are unknown, a view is empty or the filter is unknown.
+	- BITMAP_ERROR_MEMORY               Insufficient memory.
+**********************************************************************************************************************************************************************/
+
+bitmap_error_t bitmapResampleView(const bitmap_view_t* input, const bitmap_view_t* output, bitmap_filter_t filter);
+
+//Parse a filter name ("bilinear", "bicubic" or "lanczos"). Returns BITMAP_BOOL_FALSE for unknown names.
+bitmap_bool_t bitmapParseFilter(const char* name, bitmap_filter_t* filter);
+
+#endif